@@ -0,0 +1,38 @@
+/// Format of the page reference traces written by the MMU.
+///
+/// A trace file starts with a `pageTraceHeader`, followed by one
+/// `pageTraceRecord` per successful address translation, in the order
+/// they happened.  Fields are stored in host byte order.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_BIN_PAGETRACE__H
+#define NACHOS_BIN_PAGETRACE__H
+
+
+#include <stdint.h>
+
+
+/// Magic number denoting a trace file.  It changes with the layout of the
+/// records, so traces in an older format are rejected instead of misread:
+/// `0x50475452` ("PGTR") had 16-bit `pid` and `flags` fields.
+#define PAGE_TRACE_MAGIC  0x50475432  // "PGT2".
+
+#define PAGE_TRACE_WRITE  0x1  // The reference was a write.
+
+typedef struct pageTraceHeader {
+    uint32_t magic;     // Should be `PAGE_TRACE_MAGIC`.
+    uint32_t pageSize;  // Page size of the traced machine, in bytes.
+} pageTraceHeader;
+
+typedef struct pageTraceRecord {
+    uint32_t tick;   // Simulated time of the reference.
+    uint32_t vpn;    // Virtual page referenced.
+    uint32_t pid;    // Process that made the reference.
+    uint32_t flags;  // Combination of `PAGE_TRACE_*` flags.
+} pageTraceRecord;
+
+
+#endif
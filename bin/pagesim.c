@@ -0,0 +1,327 @@
+/// Program that replays a page reference trace against several page
+/// replacement policies, for a range of physical memory sizes.
+///
+/// Traces are produced by running Nachos with `-pt <trace file>`.  Frames
+/// are shared by all processes, as in the kernel's core map.  For every
+/// memory size given, the number of page faults, of pages read back from
+/// swap and of dirty pages written to swap is printed for each policy.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "page_trace.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+enum policy { FIFO, CLOCK, RANDOM, LRU, OPT, NUM_POLICIES };
+
+static const char *policyNames[NUM_POLICIES] = {
+    "FIFO", "Clock", "Random", "LRU", "OPT"
+};
+
+/// A trace reduced to what the policies need: a dense page id per
+/// reference, whether it was a write, and when that page is used next.
+typedef struct trace {
+    unsigned length;
+    unsigned numPages;   // Distinct (pid, vpn) pairs.
+    unsigned *page;
+    bool *write;
+    unsigned *nextUse;   // Index of the next reference to the same page,
+                         // or `length` if there is none.
+} trace;
+
+typedef struct result {
+    unsigned long faults;
+    unsigned long swapIns;
+    unsigned long swapOuts;
+} result;
+
+
+/// Open addressing table mapping (pid, vpn) keys to dense page ids.
+typedef struct pageMap {
+    uint64_t *keys;
+    unsigned *ids;
+    unsigned capacity;  // Always a power of two.
+    unsigned count;
+} pageMap;
+
+static unsigned
+Hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (unsigned) key;
+}
+
+static void
+MapInit(pageMap *m, unsigned capacity)
+{
+    m->capacity = capacity;
+    m->count = 0;
+    m->keys = malloc(capacity * sizeof *m->keys);
+    m->ids = malloc(capacity * sizeof *m->ids);
+    if (m->keys == NULL || m->ids == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (unsigned i = 0; i < capacity; i++) {
+        m->ids[i] = (unsigned) -1;
+    }
+}
+
+static unsigned MapLookup(pageMap *m, uint64_t key);
+
+static void
+MapGrow(pageMap *m)
+{
+    pageMap bigger;
+    MapInit(&bigger, m->capacity * 2);
+    for (unsigned i = 0; i < m->capacity; i++) {
+        if (m->ids[i] != (unsigned) -1) {
+            unsigned slot = Hash(m->keys[i]) & (bigger.capacity - 1);
+            while (bigger.ids[slot] != (unsigned) -1) {
+                slot = (slot + 1) & (bigger.capacity - 1);
+            }
+            bigger.keys[slot] = m->keys[i];
+            bigger.ids[slot] = m->ids[i];
+        }
+    }
+    bigger.count = m->count;
+    free(m->keys);
+    free(m->ids);
+    *m = bigger;
+}
+
+/// Return the id of `key`, assigning the next free one if it is new.
+static unsigned
+MapLookup(pageMap *m, uint64_t key)
+{
+    if (2 * (m->count + 1) > m->capacity) {
+        MapGrow(m);
+    }
+    unsigned slot = Hash(key) & (m->capacity - 1);
+    while (m->ids[slot] != (unsigned) -1) {
+        if (m->keys[slot] == key) {
+            return m->ids[slot];
+        }
+        slot = (slot + 1) & (m->capacity - 1);
+    }
+    m->keys[slot] = key;
+    m->ids[slot] = m->count;
+    return m->count++;
+}
+
+static bool
+LoadTrace(const char *path, trace *t)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    pageTraceHeader h;
+    if (fread(&h, sizeof h, 1, f) != 1 || h.magic != PAGE_TRACE_MAGIC) {
+        fprintf(stderr, "%s: not a page trace file in the current format\n",
+                path);
+        fclose(f);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f) - (long) sizeof h;
+    fseek(f, sizeof h, SEEK_SET);
+
+    t->length = (unsigned) (size / sizeof (pageTraceRecord));
+    t->page = malloc(t->length * sizeof *t->page);
+    t->write = malloc(t->length * sizeof *t->write);
+    t->nextUse = malloc(t->length * sizeof *t->nextUse);
+    if (t->length > 0
+          && (t->page == NULL || t->write == NULL || t->nextUse == NULL)) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    pageMap map;
+    MapInit(&map, 1024);
+    pageTraceRecord r;
+    for (unsigned i = 0; i < t->length; i++) {
+        if (fread(&r, sizeof r, 1, f) != 1) {
+            t->length = i;
+            break;
+        }
+        t->page[i] = MapLookup(&map, (uint64_t) r.pid << 32 | r.vpn);
+        t->write[i] = (r.flags & PAGE_TRACE_WRITE) != 0;
+    }
+    fclose(f);
+    t->numPages = map.count;
+    free(map.keys);
+    free(map.ids);
+
+    // Walk backwards to find, for every reference, the next use of the
+    // same page.  Only OPT needs this, but it is cheap.
+    unsigned *last = malloc((t->numPages + 1) * sizeof *last);
+    for (unsigned p = 0; p < t->numPages; p++) {
+        last[p] = t->length;
+    }
+    for (unsigned i = t->length; i-- > 0;) {
+        t->nextUse[i] = last[t->page[i]];
+        last[t->page[i]] = i;
+    }
+    free(last);
+    return true;
+}
+
+/// Pick the frame to evict, among `numFrames` full frames.
+static unsigned
+PickVictim(enum policy p, unsigned numFrames, unsigned *hand, bool *use,
+           const unsigned *stamp)
+{
+    unsigned victim = 0;
+    switch (p) {
+        case FIFO:
+            victim = *hand;
+            *hand = (*hand + 1) % numFrames;
+            break;
+
+        case CLOCK:
+            while (use[*hand]) {
+                use[*hand] = false;
+                *hand = (*hand + 1) % numFrames;
+            }
+            victim = *hand;
+            *hand = (*hand + 1) % numFrames;
+            break;
+
+        case RANDOM:
+            victim = (unsigned) rand() % numFrames;
+            break;
+
+        case LRU:   // `stamp` holds the time of the last use.
+            for (unsigned i = 1; i < numFrames; i++) {
+                if (stamp[i] < stamp[victim]) {
+                    victim = i;
+                }
+            }
+            break;
+
+        case OPT:   // `stamp` holds the time of the next use.
+            for (unsigned i = 1; i < numFrames; i++) {
+                if (stamp[i] > stamp[victim]) {
+                    victim = i;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+    return victim;
+}
+
+static result
+Simulate(const trace *t, enum policy p, unsigned numFrames)
+{
+    result res = { 0, 0, 0 };
+
+    unsigned *frame = malloc(numFrames * sizeof *frame);
+    bool *use = calloc(numFrames, sizeof *use);
+    bool *dirty = calloc(numFrames, sizeof *dirty);
+    unsigned *stamp = calloc(numFrames, sizeof *stamp);
+    unsigned *where = malloc((t->numPages + 1) * sizeof *where);
+    bool *swapped = calloc(t->numPages + 1, sizeof *swapped);
+    if (frame == NULL || use == NULL || dirty == NULL || stamp == NULL
+          || where == NULL || swapped == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (unsigned i = 0; i < t->numPages; i++) {
+        where[i] = (unsigned) -1;
+    }
+
+    srand(1);
+    unsigned used = 0;
+    unsigned hand = 0;
+    for (unsigned i = 0; i < t->length; i++) {
+        unsigned page = t->page[i];
+        unsigned f = where[page];
+
+        if (f == (unsigned) -1) {
+            res.faults++;
+            if (swapped[page]) {
+                res.swapIns++;
+            }
+            if (used < numFrames) {
+                f = used++;
+            } else {
+                f = PickVictim(p, numFrames, &hand, use, stamp);
+                unsigned old = frame[f];
+                where[old] = (unsigned) -1;
+                if (dirty[f]) {
+                    res.swapOuts++;
+                    swapped[old] = true;
+                }
+            }
+            frame[f] = page;
+            where[page] = f;
+            dirty[f] = false;
+        }
+
+        use[f] = true;
+        if (t->write[i]) {
+            dirty[f] = true;
+        }
+        stamp[f] = p == OPT ? t->nextUse[i] : i;
+    }
+
+    free(frame);
+    free(use);
+    free(dirty);
+    free(stamp);
+    free(where);
+    free(swapped);
+    return res;
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <trace file> <num frames>...\n", argv[0]);
+        return 1;
+    }
+
+    trace t;
+    if (!LoadTrace(argv[1], &t)) {
+        return 1;
+    }
+    printf("%s: %u references, %u distinct pages\n\n",
+           argv[1], t.length, t.numPages);
+
+    printf("%8s %8s %10s %10s %10s\n",
+           "Frames", "Policy", "Faults", "Swap ins", "Swap outs");
+    for (int a = 2; a < argc; a++) {
+        int numFrames = atoi(argv[a]);
+        if (numFrames <= 0) {
+            fprintf(stderr, "Invalid number of frames: %s\n", argv[a]);
+            return 1;
+        }
+        for (int p = 0; p < NUM_POLICIES; p++) {
+            result r = Simulate(&t, (enum policy) p, (unsigned) numFrames);
+            printf("%8d %8s %10lu %10lu %10lu\n", numFrames, policyNames[p],
+                   r.faults, r.swapIns, r.swapOuts);
+        }
+    }
+
+    free(t.page);
+    free(t.write);
+    free(t.nextUse);
+    return 0;
+}
@@ -9,10 +9,8 @@
 /// ReadFrom/WriteBack to fetch the contents of the directory from disk, and
 /// to write back any modifications back to disk.
 ///
-/// Also, this implementation has the restriction that the size of the
-/// directory cannot expand.  In other words, once all the entries in the
-/// directory are used, no more files can be created.  Fixing this is one of
-/// the parts to the assignment.
+/// The table doubles when all of its entries are used, and the directory
+/// file grows with it when written back.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
@@ -24,6 +22,7 @@
 #include "directory_entry.hh"
 #include "file_header.hh"
 #include "lib/utility.hh"
+#include "machine/disk.hh"
 
 #include <stdio.h>
 #include <string.h>
@@ -37,17 +36,93 @@
 Directory::Directory(unsigned size)
 {
     ASSERT(size > 0);
-    raw.table = new DirectoryEntry [size];
-    raw.tableSize = size;
-    for (unsigned i = 0; i < raw.tableSize; i++) {
-        raw.table[i].inUse = false;
-    }
+    raw.table = nullptr;
+    raw.tableSize = 0;
+    hashHeads = hashNext = nullptr;
+    numBuckets = 0;
+    numUsed = 0;
+    Resize(size);
+    dirtyLow = 0;
+    dirtyHigh = size;
 }
 
 /// De-allocate directory data structure.
 Directory::~Directory()
 {
     delete [] raw.table;
+    delete [] hashHeads;
+    delete [] hashNext;
+}
+
+void
+Directory::Resize(unsigned size)
+{
+    DirectoryEntry *table = new DirectoryEntry [size];
+    for (unsigned i = 0; i < size; i++) {
+        if (i < raw.tableSize) {
+            table[i] = raw.table[i];
+        } else {
+            table[i].inUse = false;
+            table[i].isDirectory = false;
+        }
+    }
+    delete [] raw.table;
+    raw.table = table;
+    raw.tableSize = size;
+    Rehash();
+}
+
+unsigned
+Directory::Bucket(const char *name) const
+{
+    // FNV-1a.
+    unsigned h = 2166136261U;
+    for (unsigned i = 0; i < FILE_NAME_MAX_LEN && name[i] != '\0'; i++) {
+        h = (h ^ (unsigned char) name[i]) * 16777619U;
+    }
+    return h & (numBuckets - 1);
+}
+
+void
+Directory::HashInsert(unsigned i)
+{
+    unsigned b = Bucket(raw.table[i].name);
+    hashNext[i] = hashHeads[b];
+    hashHeads[b] = i;
+}
+
+void
+Directory::HashRemove(unsigned i)
+{
+    int *link = &hashHeads[Bucket(raw.table[i].name)];
+    while (*link != (int) i) {
+        ASSERT(*link != -1);
+        link = &hashNext[*link];
+    }
+    *link = hashNext[i];
+}
+
+void
+Directory::Rehash()
+{
+    numBuckets = 1;
+    while (numBuckets < raw.tableSize) {
+        numBuckets *= 2;
+    }
+    delete [] hashHeads;
+    delete [] hashNext;
+    hashHeads = new int [numBuckets];
+    hashNext = new int [raw.tableSize];
+    for (unsigned b = 0; b < numBuckets; b++) {
+        hashHeads[b] = -1;
+    }
+    numUsed = 0;
+    for (unsigned i = 0; i < raw.tableSize; i++) {
+        if (raw.table[i].inUse) {
+            HashInsert(i);
+            numUsed++;
+        }
+    }
 }
 
 /// Read the contents of the directory from disk.
@@ -57,19 +132,58 @@ void
 Directory::FetchFrom(OpenFile *file)
 {
     ASSERT(file != nullptr);
+
+    unsigned size = file->Length() / sizeof (DirectoryEntry);
+    ASSERT(size > 0);
+    delete [] raw.table;
+    raw.table = new DirectoryEntry [size];
+    raw.tableSize = size;
     file->ReadAt((char *) raw.table,
                  raw.tableSize * sizeof (DirectoryEntry), 0);
+    for (unsigned i = 0; i < raw.tableSize; i++) {
+        raw.table[i].name[FILE_NAME_MAX_LEN] = '\0';
+    }
+    Rehash();
+    dirtyLow = dirtyHigh = 0;
 }
 
 /// Write any modifications to the directory back to disk.
 ///
 /// * `file` is a file to contain the new directory contents.
-void
+bool
 Directory::WriteBack(OpenFile *file)
 {
     ASSERT(file != nullptr);
-    file->WriteAt((char *) raw.table,
-                  raw.tableSize * sizeof (DirectoryEntry), 0);
+
+    if (dirtyLow >= dirtyHigh) {
+        return true;
+    }
+    // Whole sectors, so that nothing has to be read back first.
+    unsigned size = raw.tableSize * sizeof (DirectoryEntry);
+    unsigned first = dirtyLow * sizeof (DirectoryEntry)
+                     / SECTOR_SIZE * SECTOR_SIZE;
+    unsigned last = DivRoundUp(dirtyHigh * (unsigned) sizeof (DirectoryEntry),
+                               SECTOR_SIZE) * SECTOR_SIZE;
+    if (last > size) {
+        last = size;
+    }
+    int written = file->WriteAt((char *) raw.table + first,
+                                last - first, first);
+    dirtyLow = dirtyHigh = 0;
+    return written == (int) (last - first);
+}
+
+void
+Directory::Touch(unsigned i)
+{
+    if (dirtyLow >= dirtyHigh) {
+        dirtyLow = i;
+        dirtyHigh = i + 1;
+    } else if (i < dirtyLow) {
+        dirtyLow = i;
+    } else if (i >= dirtyHigh) {
+        dirtyHigh = i + 1;
+    }
 }
 
 /// Look up file name in directory, and return its location in the table of
@@ -81,9 +195,8 @@ Directory::FindIndex(const char *name)
 {
     ASSERT(name != nullptr);
 
-    for (unsigned i = 0; i < raw.tableSize; i++) {
-        if (raw.table[i].inUse
-              && !strncmp(raw.table[i].name, name, FILE_NAME_MAX_LEN)) {
+    for (int i = hashHeads[Bucket(name)]; i != -1; i = hashNext[i]) {
+        if (!strncmp(raw.table[i].name, name, FILE_NAME_MAX_LEN)) {
             return i;
         }
     }
@@ -95,26 +208,31 @@ Directory::FindIndex(const char *name)
 /// directory.
 ///
 /// * `name` is the file name to look up.
+/// * `isDirectory` receives whether the entry is a directory, if not null.
 int
-Directory::Find(const char *name)
+Directory::Find(const char *name, bool *isDirectory)
 {
     ASSERT(name != nullptr);
 
     int i = FindIndex(name);
     if (i != -1) {
+        if (isDirectory != nullptr) {
+            *isDirectory = raw.table[i].isDirectory;
+        }
         return raw.table[i].sector;
     }
     return -1;
 }
 
 /// Add a file into the directory.  Return true if successful; return false
-/// if the file name is already in the directory, or if the directory is
-/// completely full, and has no more space for additional file names.
+/// if the file name is already in the directory.  If the table is full, it
+/// doubles; the file grows when the table is written back.
 ///
 /// * `name` is the name of the file being added.
 /// * `newSector` is the disk sector containing the added file's header.
+/// * `isDirectory` tells whether the new entry is a directory.
 bool
-Directory::Add(const char *name, int newSector)
+Directory::Add(const char *name, int newSector, bool isDirectory)
 {
     ASSERT(name != nullptr);
 
@@ -122,15 +240,27 @@ Directory::Add(const char *name, int newSector)
         return false;
     }
 
+    if (numUsed == raw.tableSize) {
+        unsigned oldSize = raw.tableSize;
+        Resize(2 * oldSize);
+        Touch(oldSize);
+        Touch(raw.tableSize - 1);
+    }
     for (unsigned i = 0; i < raw.tableSize; i++) {
         if (!raw.table[i].inUse) {
             raw.table[i].inUse = true;
+            raw.table[i].isDirectory = isDirectory;
             strncpy(raw.table[i].name, name, FILE_NAME_MAX_LEN);
+            raw.table[i].name[FILE_NAME_MAX_LEN] = '\0';
             raw.table[i].sector = newSector;
+            HashInsert(i);
+            numUsed++;
+            Touch(i);
             return true;
         }
     }
-    return false;  // no space.  Fix when we have extensible files.
+    ASSERT(false);  // `Resize` made room.
+    return false;
 }
 
 /// Remove a file name from the directory.   Return true if successful;
@@ -146,17 +276,27 @@ Directory::Remove(const char *name)
     if (i == -1) {
         return false;  // name not in directory
     }
+    HashRemove(i);
     raw.table[i].inUse = false;
+    numUsed--;
+    Touch(i);
     return true;
 }
 
+bool
+Directory::IsEmpty() const
+{
+    return numUsed == 0;
+}
+
 /// List all the file names in the directory.
 void
 Directory::List() const
 {
     for (unsigned i = 0; i < raw.tableSize; i++) {
         if (raw.table[i].inUse) {
-            printf("%s\n", raw.table[i].name);
+            printf("%s%s\n", raw.table[i].name,
+                   raw.table[i].isDirectory ? "/" : "");
         }
     }
 }
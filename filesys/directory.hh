@@ -20,10 +20,15 @@
 
 
 /// The following class defines a UNIX-like “directory”.  Each entry in the
-/// directory describes a file, and where to find it on disk.
+/// directory describes a file or another directory, and where to find it on
+/// disk.
 ///
 /// The directory data structure can be stored in memory, or on disk.  When
-/// it is on disk, it is stored as a regular Nachos file.
+/// it is on disk, it is stored as a regular Nachos file, which grows when
+/// the table runs out of free entries.
+///
+/// In memory, names are also kept in a hash table, so looking one up does
+/// not depend on the size of the directory.
 ///
 /// The constructor initializes a directory structure in memory; the
 /// `FetchFrom`/`WriteBack` operations shuffle the directory information
@@ -37,21 +42,31 @@ public:
     /// De-allocate the directory.
     ~Directory();
 
-    /// Initialize directory contents from disk.
+    /// Initialize directory contents from disk.  The table takes the size
+    /// of the file.
     void FetchFrom(OpenFile *file);
 
-    /// Write modifications to directory contents back to disk.
-    void WriteBack(OpenFile *file);
+    /// Write modifications to directory contents back to disk.  Only the
+    /// sectors holding entries changed since the last `FetchFrom` or
+    /// `WriteBack` are written; a new directory counts as changed
+    /// everywhere.
+    ///
+    /// Return false if the file could not grow to hold the table.
+    bool WriteBack(OpenFile *file);
 
-    /// Find the sector number of the `FileHeader` for file: `name`.
-    int Find(const char *name);
+    /// Find the sector number of the `FileHeader` for file: `name`.  If
+    /// `isDirectory` is given, it tells whether `name` is a directory.
+    int Find(const char *name, bool *isDirectory = nullptr);
 
-    /// Add a file name into the directory.
-    bool Add(const char *name, int newSector);
+    /// Add a file name into the directory, growing the table if it is full.
+    bool Add(const char *name, int newSector, bool isDirectory = false);
 
     /// Remove a file from the directory.
     bool Remove(const char *name);
 
+    /// Whether the directory has no entries.
+    bool IsEmpty() const;
+
     /// Print the names of all the files in the directory.
     void List() const;
 
@@ -69,7 +84,30 @@ private:
     /// Find the index into the directory table corresponding to `name`.
     int FindIndex(const char *name);
 
+    /// Note that entry `i` changed.
+    void Touch(unsigned i);
+
+    /// Make the table `size` entries long, keeping its contents.
+    void Resize(unsigned size);
+
+    /// Bucket of `name` in `hashHeads`.
+    unsigned Bucket(const char *name) const;
+
+    /// Put entry `i` into / take it out of its hash chain.
+    void HashInsert(unsigned i);
+    void HashRemove(unsigned i);
+
+    /// Rebuild the hash table from scratch.
+    void Rehash();
+
     RawDirectory raw;
+    unsigned dirtyLow;   ///< Range of entries changed, empty if
+    unsigned dirtyHigh;  ///< `dirtyLow >= dirtyHigh`.
+    unsigned numUsed;    ///< Entries in use.
+
+    int *hashHeads;      ///< First entry of each chain, or -1.
+    unsigned numBuckets; ///< Always a power of two, at least `tableSize`.
+    int *hashNext;       ///< Next entry in the same chain, per entry.
 };
 
 
@@ -10,6 +10,9 @@
 /// For simplicity, we assume file names are <= 9 characters long.
 const unsigned FILE_NAME_MAX_LEN = 20;
 
+/// Maximum length of a path: names separated by `/`.
+const unsigned PATH_NAME_MAX_LEN = 127;
+
 /// The following class defines a "directory entry", representing a file in
 /// the directory.  Each entry gives the name of the file, and where the
 /// file's header is to be found on disk.
@@ -20,6 +23,8 @@ class DirectoryEntry {
 public:
     /// Is this directory entry in use?
     bool inUse;
+    /// Is the entry a directory rather than a file?
+    bool isDirectory;
     /// Location on disk to find the `FileHeader` for this file.
     unsigned sector;
     /// Text name for file, with +1 for the trailing `'\0'`.
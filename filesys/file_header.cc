@@ -4,9 +4,13 @@
 /// The file header is used to locate where on disk the file's data is
 /// stored.  We implement this as a fixed size table of pointers -- each
 /// entry in the table points to the disk sector containing that portion of
-/// the file data (in other words, there are no indirect or doubly indirect
-/// blocks). The table size is chosen so that the file header will be just
-/// big enough to fit in one disk sector,
+/// the file data -- followed by a single indirect block, listing the next
+/// sectors, and a double indirect block, listing index blocks for the rest.
+/// The table size is chosen so that the file header will be just big
+/// enough to fit in one disk sector.
+///
+/// Sectors are allocated in extents -- runs of consecutive sectors -- so
+/// that reading a file sequentially seldom has to seek.
 ///
 /// Unlike in a real system, we do not keep track of file permissions,
 /// ownership, last modification date, etc., in the file header.
@@ -30,9 +34,115 @@
 #include <stdio.h>
 
 
+FileHeader::FileHeader()
+{
+    raw.numBytes = raw.numSectors = 0;
+    raw.singleIndirect = raw.doubleIndirect = 0;
+    dataSectors = nullptr;
+    for (unsigned i = 0; i < NUM_INDIRECT; i++) {
+        secondLevel[i] = 0;
+    }
+}
+
+FileHeader::~FileHeader()
+{
+    delete [] dataSectors;
+}
+
+unsigned
+FileHeader::IndexSectorsFor(unsigned numSectors)
+{
+    if (numSectors <= NUM_DIRECT) {
+        return 0;
+    }
+    numSectors -= NUM_DIRECT;
+    if (numSectors <= NUM_INDIRECT) {
+        return 1;
+    }
+    numSectors -= NUM_INDIRECT;
+    return 2 + DivRoundUp(numSectors, NUM_INDIRECT);
+}
+
+unsigned
+FileHeader::NumSecondLevel() const
+{
+    unsigned n = NumIndexSectors();
+    return n > 2 ? n - 2 : 0;
+}
+
+/// Number of track boundaries crossed by `length` sectors from `start`.
+static unsigned
+TrackCrossings(unsigned start, unsigned length)
+{
+    return (start + length - 1) / SECTORS_PER_TRACK
+           - start / SECTORS_PER_TRACK;
+}
+
+/// Allocate up to `want` consecutive sectors out of `freeMap`.
+///
+/// Takes the smallest free extent that holds all of them (best fit), and
+/// among extents of that size, the one where they cross the fewest track
+/// boundaries.  If no extent is large enough, takes the largest one, so
+/// that the caller needs as few extents as possible.
+///
+/// Return the first sector allocated and set `*got` to how many were, or
+/// return -1 if no sector is free.
+static int
+AllocateExtent(Bitmap *freeMap, unsigned want, unsigned *got)
+{
+    ASSERT(want > 0);
+
+    unsigned bestStart = 0, bestLength = 0;
+    unsigned start, length;
+    for (unsigned from = 0; freeMap->NextClearRun(from, &start, &length);
+         from = start + length) {
+        bool better;
+        if (bestLength == 0) {
+            better = true;
+        } else if ((length >= want) != (bestLength >= want)) {
+            better = length >= want;
+        } else if (length < want) {
+            better = length > bestLength;
+        } else if (length != bestLength) {
+            better = length < bestLength;
+        } else {
+            better = TrackCrossings(start, want)
+                     < TrackCrossings(bestStart, want);
+        }
+        if (better) {
+            bestStart = start;
+            bestLength = length;
+        }
+    }
+    if (bestLength == 0) {
+        return -1;
+    }
+
+    *got = want < bestLength ? want : bestLength;
+    freeMap->MarkRun(bestStart, *got);
+    DEBUG('f', "Allocated extent of %u sectors at %u.\n", *got, bestStart);
+    return bestStart;
+}
+
+/// Allocate `count` sectors, in as few extents as possible, into
+/// `sectors`.  There must be enough free sectors.
+static void
+AllocateSectors(Bitmap *freeMap, unsigned count, unsigned *sectors)
+{
+    for (unsigned n = 0; n < count;) {
+        unsigned got;
+        int first = AllocateExtent(freeMap, count - n, &got);
+        ASSERT(first != -1);
+        for (unsigned k = 0; k < got; k++) {
+            sectors[n++] = first + k;
+        }
+    }
+}
+
 /// Initialize a fresh file header for a newly created file.  Allocate data
-/// blocks for the file out of the map of free disk blocks.  Return false if
-/// there are not enough free blocks to accomodate the new file.
+/// blocks for the file, and the index blocks needed to reach them, out of
+/// the map of free disk blocks.  Return false if there are not enough free
+/// blocks to accomodate the new file.
 ///
 /// * `freeMap` is the bit map of free disk sectors.
 /// * `fileSize` is the bit map of free disk sectors.
@@ -45,19 +155,143 @@ FileHeader::Allocate(Bitmap *freeMap, unsigned fileSize)
         return false;
     }
 
-    raw.numBytes = fileSize;
-    raw.numSectors = DivRoundUp(fileSize, SECTOR_SIZE);
-    if (freeMap->CountClear() < raw.numSectors) {
+    unsigned numSectors = DivRoundUp(fileSize, SECTOR_SIZE);
+    if (freeMap->CountClear() < numSectors + IndexSectorsFor(numSectors)) {
         return false;  // Not enough space.
     }
 
-    for (unsigned i = 0; i < raw.numSectors; i++) {
-        raw.dataSectors[i] = freeMap->Find();
+    raw.numBytes = fileSize;
+    raw.numSectors = numSectors;
+
+    // Index blocks and data all come from the same extents, index blocks
+    // first, so that the file is laid out in the order it is read.
+    unsigned numIndex = NumIndexSectors();
+    unsigned *sectors = new unsigned [numIndex + numSectors];
+    AllocateSectors(freeMap, numIndex + numSectors, sectors);
+
+    unsigned next = 0;
+    raw.singleIndirect = numIndex > 0 ? sectors[next++] : 0;
+    raw.doubleIndirect = numIndex > 1 ? sectors[next++] : 0;
+    for (unsigned i = 0; i < NUM_INDIRECT; i++) {
+        secondLevel[i] = i < NumSecondLevel() ? sectors[next++] : 0;
+    }
+    delete [] dataSectors;
+    dataSectors = new unsigned [numSectors];
+    for (unsigned i = 0; i < numSectors; i++) {
+        dataSectors[i] = sectors[next++];
+    }
+    delete [] sectors;
+
+    for (unsigned i = 0; i < NUM_DIRECT; i++) {
+        raw.dataSectors[i] = i < numSectors ? dataSectors[i] : 0;
+    }
+    return true;
+}
+
+/// Allocate `count` sectors following `last` where they are free, and the
+/// rest anywhere else.
+static void
+AllocateSectorsAfter(Bitmap *freeMap, unsigned last, unsigned count,
+                     unsigned *sectors)
+{
+    unsigned n = 0;
+    for (unsigned s = last + 1;
+         n < count && s < NUM_SECTORS && !freeMap->Test(s); s++) {
+        freeMap->Mark(s);
+        sectors[n++] = s;
+    }
+    AllocateSectors(freeMap, count - n, &sectors[n]);
+}
+
+bool
+FileHeader::GrowInPlace(unsigned newSize)
+{
+    if (DivRoundUp(newSize, SECTOR_SIZE) > raw.numSectors) {
+        return false;
+    }
+    if (newSize > raw.numBytes) {
+        raw.numBytes = newSize;
     }
     return true;
 }
 
-/// De-allocate all the space allocated for data blocks for this file.
+/// Grow the file.  New data sectors continue the file's last extent when
+/// the sectors after it are free.  The file gets spare sectors beyond
+/// `newSize`, as many as it had already, up to `MAX_PREALLOCATED_SECTORS`,
+/// unless the disk is too full for them.
+///
+/// * `freeMap` is the bit map of free disk sectors.
+/// * `newSize` is the new length of the file, in bytes.
+bool
+FileHeader::Extend(Bitmap *freeMap, unsigned newSize)
+{
+    ASSERT(freeMap != nullptr);
+
+    if (GrowInPlace(newSize)) {
+        return true;
+    }
+    if (newSize > MAX_FILE_SIZE) {
+        return false;
+    }
+
+    unsigned oldSectors = raw.numSectors;
+    unsigned oldIndex = NumIndexSectors();
+    unsigned needed = DivRoundUp(newSize, SECTOR_SIZE);
+    unsigned spare = oldSectors < MAX_PREALLOCATED_SECTORS
+                     ? oldSectors : MAX_PREALLOCATED_SECTORS;
+    unsigned target = needed + spare;
+    if (target > MAX_FILE_SECTORS) {
+        target = MAX_FILE_SECTORS;
+    }
+    unsigned available = freeMap->CountClear();
+    if (available < target - oldSectors + IndexSectorsFor(target) - oldIndex) {
+        target = needed;  // No room for spares.
+        if (available
+              < target - oldSectors + IndexSectorsFor(target) - oldIndex) {
+            return false;
+        }
+    }
+
+    unsigned *newTable = new unsigned [target];
+    for (unsigned i = 0; i < oldSectors; i++) {
+        newTable[i] = dataSectors[i];
+    }
+    if (oldSectors > 0) {
+        AllocateSectorsAfter(freeMap, dataSectors[oldSectors - 1],
+                             target - oldSectors, &newTable[oldSectors]);
+    } else {
+        AllocateSectors(freeMap, target, newTable);
+    }
+    delete [] dataSectors;
+    dataSectors = newTable;
+    raw.numSectors = target;
+    raw.numBytes = newSize;
+
+    for (unsigned i = oldSectors; i < target && i < NUM_DIRECT; i++) {
+        raw.dataSectors[i] = dataSectors[i];
+    }
+
+    // Index blocks are only read when the file is opened, so they can go
+    // wherever there is a hole.
+    unsigned numIndex = NumIndexSectors();
+    for (unsigned i = oldIndex; i < numIndex; i++) {
+        unsigned sector;
+        AllocateSectors(freeMap, 1, &sector);
+        if (i == 0) {
+            raw.singleIndirect = sector;
+        } else if (i == 1) {
+            raw.doubleIndirect = sector;
+        } else {
+            secondLevel[i - 2] = sector;
+        }
+    }
+    DEBUG('f', "Extended file to %u bytes, %u sectors.\n",
+          newSize, target);
+    return true;
+}
+
+/// De-allocate all the space allocated for data and index blocks for this
+/// file.
 ///
 /// * `freeMap` is the bit map of free disk sectors.
 void
@@ -66,39 +300,122 @@ FileHeader::Deallocate(Bitmap *freeMap)
     ASSERT(freeMap != nullptr);
 
     for (unsigned i = 0; i < raw.numSectors; i++) {
-        ASSERT(freeMap->Test(raw.dataSectors[i]));  // ought to be marked!
-        freeMap->Clear(raw.dataSectors[i]);
+        ASSERT(freeMap->Test(dataSectors[i]));  // ought to be marked!
+        freeMap->Clear(dataSectors[i]);
+    }
+    for (unsigned i = 0; i < NumIndexSectors(); i++) {
+        ASSERT(freeMap->Test(IndexSector(i)));
+        freeMap->Clear(IndexSector(i));
+    }
+}
+
+/// Read an index block.  Out of range sectors read as a block of invalid
+/// sector numbers, so that a damaged header can still be checked.
+static void
+ReadIndexBlock(unsigned sector, RawIndexBlock *block)
+{
+    if (sector >= NUM_SECTORS) {
+        for (unsigned i = 0; i < NUM_INDIRECT; i++) {
+            block->sectors[i] = NUM_SECTORS;
+        }
+        return;
     }
+    synchDisk->ReadSector(sector, (char *) block);
 }
 
-/// Fetch contents of file header from disk.
+/// Fetch contents of file header from disk, along with its index blocks.
 ///
 /// * `sector` is the disk sector containing the file header.
 void
 FileHeader::FetchFrom(unsigned sector)
 {
     synchDisk->ReadSector(sector, (char *) &raw);
+
+    unsigned numSectors = raw.numSectors;
+    if (numSectors > MAX_FILE_SECTORS) {
+        numSectors = MAX_FILE_SECTORS;  // Damaged; let `Check` tell.
+    }
+    delete [] dataSectors;
+    dataSectors = new unsigned [numSectors];
+    for (unsigned i = 0; i < NUM_INDIRECT; i++) {
+        secondLevel[i] = 0;
+    }
+
+    RawIndexBlock block;
+    for (unsigned i = 0; i < numSectors; i++) {
+        if (i < NUM_DIRECT) {
+            dataSectors[i] = raw.dataSectors[i];
+            continue;
+        }
+        unsigned j = i - NUM_DIRECT;
+        if (j < NUM_INDIRECT) {
+            if (j == 0) {
+                ReadIndexBlock(raw.singleIndirect, &block);
+            }
+            dataSectors[i] = block.sectors[j];
+            continue;
+        }
+        j -= NUM_INDIRECT;
+        if (j == 0) {
+            ReadIndexBlock(raw.doubleIndirect, &block);
+            for (unsigned k = 0; k < NUM_INDIRECT; k++) {
+                secondLevel[k] = block.sectors[k];
+            }
+        }
+        if (j % NUM_INDIRECT == 0) {
+            ReadIndexBlock(secondLevel[j / NUM_INDIRECT], &block);
+        }
+        dataSectors[i] = block.sectors[j % NUM_INDIRECT];
+    }
+}
+
+/// Fill `block` with the data sectors from the `first`-th on.
+void
+FileHeader::FillIndexBlock(RawIndexBlock *block, unsigned first) const
+{
+    for (unsigned k = 0; k < NUM_INDIRECT; k++) {
+        block->sectors[k] = first + k < raw.numSectors
+                            ? dataSectors[first + k] : 0;
+    }
 }
 
-/// Write the modified contents of the file header back to disk.
+/// Write the modified contents of the file header back to disk.  Index
+/// blocks are written before the header, so that the header never leads
+/// to one that is not there yet.
 ///
 /// * `sector` is the disk sector to contain the file header.
 void
 FileHeader::WriteBack(unsigned sector)
 {
+    RawIndexBlock block;
+
+    if (raw.singleIndirect != 0) {
+        FillIndexBlock(&block, NUM_DIRECT);
+        synchDisk->WriteSector(raw.singleIndirect, (char *) &block);
+    }
+    if (raw.doubleIndirect != 0) {
+        for (unsigned i = 0; i < NumSecondLevel(); i++) {
+            FillIndexBlock(&block, NUM_DIRECT + NUM_INDIRECT
+                                   + i * NUM_INDIRECT);
+            synchDisk->WriteSector(secondLevel[i], (char *) &block);
+        }
+        synchDisk->WriteSector(raw.doubleIndirect, (char *) secondLevel);
+    }
     synchDisk->WriteSector(sector, (char *) &raw);
 }
 
 /// Return which disk sector is storing a particular byte within the file.
 /// This is essentially a translation from a virtual address (the offset in
 /// the file) to a physical address (the sector where the data at the offset
-/// is stored).
+/// is stored).  The index blocks were read along with the header, so this
+/// does not touch the disk.
 ///
 /// * `offset` is the location within the file of the byte in question.
 unsigned
 FileHeader::ByteToSector(unsigned offset)
 {
-    return raw.dataSectors[offset / SECTOR_SIZE];
+    ASSERT(offset / SECTOR_SIZE < raw.numSectors);
+    return dataSectors[offset / SECTOR_SIZE];
 }
 
 /// Return the number of bytes in the file.
@@ -122,17 +439,34 @@ FileHeader::Print(const char *title)
     }
 
     printf("    size: %u bytes\n"
-           "    block indexes: ",
+           "    block extents: ",
            raw.numBytes);
 
-    for (unsigned i = 0; i < raw.numSectors; i++) {
-        printf("%u ", raw.dataSectors[i]);
+    for (unsigned i = 0; i < raw.numSectors;) {
+        unsigned j = i + 1;
+        while (j < raw.numSectors && dataSectors[j] == dataSectors[j - 1] + 1) {
+            j++;
+        }
+        if (j - i == 1) {
+            printf("%u ", dataSectors[i]);
+        } else {
+            printf("%u-%u ", dataSectors[i], dataSectors[j - 1]);
+        }
+        i = j;
     }
     printf("\n");
 
+    if (NumIndexSectors() > 0) {
+        printf("    index blocks: ");
+        for (unsigned i = 0; i < NumIndexSectors(); i++) {
+            printf("%u ", IndexSector(i));
+        }
+        printf("\n");
+    }
+
     for (unsigned i = 0, k = 0; i < raw.numSectors; i++) {
-        printf("    contents of block %u:\n", raw.dataSectors[i]);
-        synchDisk->ReadSector(raw.dataSectors[i], data);
+        printf("    contents of block %u:\n", dataSectors[i]);
+        synchDisk->ReadSector(dataSectors[i], data);
         for (unsigned j = 0; j < SECTOR_SIZE && k < raw.numBytes; j++, k++) {
             if (isprint(data[j])) {
                 printf("%c", data[j]);
@@ -150,3 +484,31 @@ FileHeader::GetRaw() const
 {
     return &raw;
 }
+
+unsigned
+FileHeader::DataSector(unsigned i) const
+{
+    ASSERT(i < raw.numSectors);
+    return dataSectors[i];
+}
+
+unsigned
+FileHeader::NumIndexSectors() const
+{
+    return IndexSectorsFor(raw.numSectors);
+}
+
+/// The single indirect block comes first, then the double indirect one and
+/// then the blocks it lists.
+unsigned
+FileHeader::IndexSector(unsigned i) const
+{
+    ASSERT(i < NumIndexSectors());
+    if (i == 0) {
+        return raw.singleIndirect;
+    } else if (i == 1) {
+        return raw.doubleIndirect;
+    } else {
+        return secondLevel[i - 2];
+    }
+}
@@ -23,17 +23,20 @@
 /// blocks.
 ///
 /// The file header data structure can be stored in memory or on disk.  When
-/// it is on disk, it is stored in a single sector -- this means that we
-/// assume the size of this data structure to be the same as one disk sector.
-/// Without indirect addressing, this limits the maximum file length to just
-/// under 4K bytes.
+/// it is on disk, it is stored in a single sector, followed by single and
+/// double indirect index blocks for files too long for the sectors listed
+/// in the header itself.  In memory, the sector numbers of all the data
+/// blocks are kept in one table, so `ByteToSector` never reads the disk.
 ///
-/// There is no constructor; rather the file header can be initialized
-/// by allocating blocks for the file (if it is a new file), or by
-/// reading it from disk.
+/// The file header is initialized by allocating blocks for the file (if it
+/// is a new file), or by reading it from disk.
 class FileHeader {
 public:
 
+    FileHeader();
+
+    ~FileHeader();
+
     /// Initialize a file header, including allocating space on disk for the
     /// file data.
     bool Allocate(Bitmap *bitMap, unsigned fileSize);
@@ -41,6 +44,15 @@ public:
     /// De-allocate this file's data blocks.
     void Deallocate(Bitmap *bitMap);
 
+    /// Make the file `newSize` bytes long, if that fits in the sectors it
+    /// already has.  Return false if it does not.
+    bool GrowInPlace(unsigned newSize);
+
+    /// Make the file `newSize` bytes long, allocating the sectors needed
+    /// (and a few more, so that the following appends do not have to).
+    /// Return false if there is not enough space.
+    bool Extend(Bitmap *freeMap, unsigned newSize);
+
     /// Initialize file header from disk.
     void FetchFrom(unsigned sectorNumber);
 
@@ -63,8 +75,26 @@ public:
     /// system at a low level.
     const RawFileHeader *GetRaw() const;
 
+    /// Return the `i`-th data sector of the file.
+    unsigned DataSector(unsigned i) const;
+
+    /// Number of index blocks used by the file, and the `i`-th of them.
+    unsigned NumIndexSectors() const;
+    unsigned IndexSector(unsigned i) const;
+
 private:
+    /// Number of index blocks needed to reach `numSectors` data sectors.
+    static unsigned IndexSectorsFor(unsigned numSectors);
+
+    /// Number of second level blocks under the double indirect block.
+    unsigned NumSecondLevel() const;
+
+    void FillIndexBlock(RawIndexBlock *block, unsigned first) const;
+
     RawFileHeader raw;
+    unsigned *dataSectors;  ///< All `raw.numSectors` data sectors.
+    unsigned secondLevel[NUM_INDIRECT];  ///< Blocks listed by the double
+                                         ///< indirect block.
 };
 
 
@@ -0,0 +1,122 @@
+/// Routines to share the headers of open files.
+///
+/// The table lock is held while a header is read in or written back, so
+/// that a file being closed for the last time cannot be opened again from a
+/// header that is not on disk yet.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "file_node_table.hh"
+#include "file_header.hh"
+#include "threads/lock.hh"
+#include "threads/rw_lock.hh"
+#include "threads/system.hh"
+
+
+FileNodeTable::FileNodeTable()
+{
+    lock = new Lock("file node table");
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        nodes[i] = nullptr;
+    }
+}
+
+FileNodeTable::~FileNodeTable()
+{
+    // Threads that never finished, such as the one that halted the
+    // machine, may still hold files open.
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        FileNode *node = nodes[i];
+        if (node != nullptr) {
+            delete node->lock;
+            delete node->hdr;
+            delete node;
+        }
+    }
+    delete lock;
+}
+
+FileNode *
+FileNodeTable::Get(unsigned sector)
+{
+    ASSERT(sector < NUM_SECTORS);
+
+    lock->Acquire();
+    FileNode *node = nodes[sector];
+    if (node != nullptr) {
+        DEBUG('f', "Sharing the header at sector %u.\n", sector);
+    } else {
+        node = new FileNode;
+        node->hdr = new FileHeader;
+        node->hdr->FetchFrom(sector);
+        node->sector = sector;
+        node->hdrDirty = false;
+        node->removed = false;
+        node->refs = 0;
+        node->lock = new ReadWriteLock("file node");
+        nodes[sector] = node;
+    }
+    node->refs++;
+    lock->Release();
+    return node;
+}
+
+void
+FileNodeTable::Release(FileNode *node)
+{
+    ASSERT(node != nullptr);
+
+    lock->Acquire();
+    ASSERT(nodes[node->sector] == node && node->refs > 0);
+    node->refs--;
+    if (node->refs == 0) {
+        if (node->removed) {
+            DEBUG('f', "Freeing removed file at sector %u.\n", node->sector);
+            fileSystem->Free(node->hdr, node->sector);
+        } else if (node->hdrDirty) {
+            node->hdr->WriteBack(node->sector);
+        }
+        nodes[node->sector] = nullptr;
+        delete node->lock;
+        delete node->hdr;
+        delete node;
+    }
+    lock->Release();
+}
+
+bool
+FileNodeTable::MarkRemoved(unsigned sector)
+{
+    ASSERT(sector < NUM_SECTORS);
+
+    lock->Acquire();
+    bool open = nodes[sector] != nullptr;
+    if (open) {
+        nodes[sector]->removed = true;
+    }
+    lock->Release();
+    return open;
+}
+
+void
+FileNodeTable::Flush()
+{
+    lock->Acquire();
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        FileNode *node = nodes[i];
+        if (node == nullptr) {
+            continue;
+        }
+        node->lock->AcquireWrite();
+        if (node->hdrDirty) {
+            DEBUG('f', "Writing back the header at sector %u.\n", i);
+            node->hdr->WriteBack(node->sector);
+            node->hdrDirty = false;
+        }
+        node->lock->ReleaseWrite();
+    }
+    lock->Release();
+}
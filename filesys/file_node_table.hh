@@ -0,0 +1,67 @@
+/// Data structures to keep the headers of open files in memory.
+///
+/// Every file that is open has a single in-memory copy of its header, found
+/// through its header sector, which all of the `OpenFile` objects on it
+/// share.  Opening a file that is already open takes no disk access, and
+/// every opener sees the same length as soon as one of them writes.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_FILESYS_FILENODETABLE__HH
+#define NACHOS_FILESYS_FILENODETABLE__HH
+
+
+#include "machine/disk.hh"
+
+
+class FileHeader;
+class Lock;
+class ReadWriteLock;
+
+/// In-memory state of an open file, shared by every `OpenFile` on it.
+struct FileNode {
+    FileHeader *hdr;      ///< Header of the file.
+    unsigned sector;      ///< Where `hdr` is stored.
+    bool hdrDirty;        ///< Whether `hdr` changed since it was written.
+    bool removed;         ///< Free the file when the last opener closes it.
+    unsigned refs;        ///< Number of `OpenFile` objects on the file.
+    ReadWriteLock *lock;  ///< Held to read while reading the file, and to
+                          ///< write while writing it or its header.
+};
+
+/// The table of all the files open in the system, indexed by header sector.
+class FileNodeTable {
+public:
+
+    FileNodeTable();
+
+    /// Forget the files still open, without writing anything back.
+    ~FileNodeTable();
+
+    /// Return the node of the file whose header is at `sector`, reading the
+    /// header in if the file is not open yet.
+    FileNode *Get(unsigned sector);
+
+    /// Drop a reference to `node`.  The last one writes the header back if
+    /// it changed, or frees the file if it was removed.
+    void Release(FileNode *node);
+
+    /// Note that the file at `sector` was taken out of its directory.
+    /// Return false if it is not open, in which case the caller frees it
+    /// right away.
+    bool MarkRemoved(unsigned sector);
+
+    /// Write back the headers of open files that changed, such as those
+    /// grown in place, so that the disk shows their current length even
+    /// if they are never closed.
+    void Flush();
+
+private:
+    Lock *lock;  ///< Protects `nodes` and the reference counts.
+    FileNode *nodes[NUM_SECTORS];  ///< Null for files that are not open.
+};
+
+
+#endif
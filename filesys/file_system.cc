@@ -5,33 +5,34 @@
 /// * a file header, stored in a sector on disk (the size of the file header
 ///   data structure is arranged to be precisely the size of 1 disk sector);
 /// * a number of data blocks;
-/// * an entry in the file system directory.
+/// * an entry in some directory.
 ///
 /// The file system consists of several data structures:
 /// * A bitmap of free disk sectors (cf. `bitmap.h`).
-/// * A directory of file names and file headers.
+/// * A tree of directories, each holding file names and file headers.
+///   Directories are themselves entries of their parent directory.
 ///
-/// Both the bitmap and the directory are represented as normal files.  Their
-/// file headers are located in specific sectors (sector 0 and sector 1), so
-/// that the file system can find them on bootup.
+/// The bitmap and the directories are represented as normal files.  The
+/// file headers of the bitmap and of the root directory are located in
+/// specific sectors (sector 0 and sector 1), so that the file system can
+/// find them on bootup.
 ///
-/// The file system assumes that the bitmap and directory files are kept
-/// “open” continuously while Nachos is running.
+/// The file system assumes that the bitmap and root directory files are
+/// kept “open” continuously while Nachos is running.  Other directories are
+/// opened as paths lead through them, and the most recently used ones are
+/// kept open.
 ///
-/// For those operations (such as `Create`, `Remove`) that modify the
-/// directory and/or bitmap, if the operation succeeds, the changes are
-/// written immediately back to disk (the two files are kept open during all
-/// this time).  If the operation fails, and we have modified part of the
-/// directory and/or bitmap, we simply discard the changed version, without
-/// writing it back to disk.
+/// The contents of the bitmap and of open directories are also kept in
+/// memory, protected by a lock for the bitmap and another for all
+/// directories.  For those operations (such as `Create`, `Remove`) that
+/// modify a directory and/or the bitmap, if the operation succeeds, the
+/// sectors holding the changed parts are written back to disk right away.
+/// If the operation fails, whatever it changed is undone.
 ///
 /// Our implementation at this point has the following restrictions:
 ///
-/// * there is no synchronization for concurrent accesses;
-/// * files have a fixed size, set when the file is created;
-/// * files cannot be bigger than about 3KB in size;
-/// * there is no hierarchical directory structure, and only a limited number
-///   of files can be added to the system;
+/// * there is no synchronization for concurrent accesses, except for the
+///   free map and the directories;
 /// * there is no attempt to make the system robust to failures (if Nachos
 ///   exits in the middle of an operation that modifies the file system, it
 ///   may corrupt the disk).
@@ -45,7 +46,10 @@
 #include "file_system.hh"
 #include "directory.hh"
 #include "file_header.hh"
+#include "file_node_table.hh"
 #include "lib/bitmap.hh"
+#include "threads/lock.hh"
+#include "threads/system.hh"
 
 #include <stdio.h>
 #include <string.h>
@@ -69,9 +73,11 @@ static const unsigned DIRECTORY_SECTOR = 1;
 FileSystem::FileSystem(bool format)
 {
     DEBUG('f', "Initializing the file system.\n");
+    freeMapLock = new Lock("free map");
+    directoryLock = new Lock("directory");
     if (format) {
-        Bitmap     *freeMap = new Bitmap(NUM_SECTORS);
-        Directory  *dir     = new Directory(NUM_DIR_ENTRIES);
+        freeMap   = new Bitmap(NUM_SECTORS);
+        directory = new Directory(NUM_DIR_ENTRIES);
         FileHeader *mapH    = new FileHeader;
         FileHeader *dirH    = new FileHeader;
 
@@ -108,60 +114,306 @@ FileSystem::FileSystem(bool format)
         // each file back to disk.  The directory at this point is completely
         // empty; but the bitmap has been changed to reflect the fact that
         // sectors on the disk have been allocated for the file headers and
-        // to hold the file data for the directory and bitmap.
+        // to hold the file data for the directory and bitmap.  Both are new,
+        // so all of their contents count as modified.
 
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
         freeMap->WriteBack(freeMapFile);     // flush changes to disk
-        dir->WriteBack(directoryFile);
+        directory->WriteBack(directoryFile);
 
         if (debug.IsEnabled('f')) {
             freeMap->Print();
-            dir->Print();
-
-            delete freeMap;
-            delete dir;
-            delete mapH;
-            delete dirH;
+            directory->Print();
         }
+        delete mapH;
+        delete dirH;
     } else {
         // If we are not formatting the disk, just open the files
         // representing the bitmap and directory; these are left open while
-        // Nachos is running.
+        // Nachos is running, and their contents are kept in memory.
         freeMapFile   = new OpenFile(FREE_MAP_SECTOR);
         directoryFile = new OpenFile(DIRECTORY_SECTOR);
+        freeMap   = new Bitmap(NUM_SECTORS);
+        directory = new Directory(NUM_DIR_ENTRIES);
+        freeMap->FetchFrom(freeMapFile);
+        directory->FetchFrom(directoryFile);
+    }
+
+    root.sector = DIRECTORY_SECTOR;
+    root.file = directoryFile;
+    root.dir = directory;
+    root.lastUse = 0;
+    for (unsigned i = 0; i < DIRECTORY_CACHE_SIZE; i++) {
+        dirCache[i].sector = 0;  // Never a directory: the free map is there.
     }
+    dirClock = 0;
 }
 
 FileSystem::~FileSystem()
 {
+    for (unsigned i = 0; i < DIRECTORY_CACHE_SIZE; i++) {
+        if (dirCache[i].sector != 0) {
+            delete dirCache[i].dir;
+            delete dirCache[i].file;
+        }
+    }
+    delete freeMap;
+    delete directory;
     delete freeMapFile;
     delete directoryFile;
+    delete freeMapLock;
+    delete directoryLock;
 }
 
-/// Create a file in the Nachos file system (similar to UNIX `create`).
-/// Since we cannot increase the size of files dynamically, we have to give
-/// `Create` the initial size of the file.
+FileSystem::CachedDirectory *
+FileSystem::GetDirectory(unsigned sector)
+{
+    if (sector == DIRECTORY_SECTOR) {
+        return &root;
+    }
+
+    CachedDirectory *victim = &dirCache[0];
+    for (unsigned i = 0; i < DIRECTORY_CACHE_SIZE; i++) {
+        CachedDirectory *d = &dirCache[i];
+        if (d->sector == sector) {
+            d->lastUse = ++dirClock;
+            return d;
+        }
+        if (victim->sector != 0
+              && (d->sector == 0 || d->lastUse < victim->lastUse)) {
+            victim = d;
+        }
+    }
+
+    // Everything is written back as soon as it changes, so evicting a
+    // directory only means closing it.  The one just used, which callers
+    // may still hold, is never the least recently used.
+    if (victim->sector != 0) {
+        DEBUG('f', "Dropping directory at sector %u.\n", victim->sector);
+        delete victim->dir;
+        delete victim->file;
+    }
+    DEBUG('f', "Reading directory at sector %u.\n", sector);
+    victim->sector = sector;
+    victim->file = new OpenFile(sector);
+    victim->dir = new Directory(NUM_DIR_ENTRIES);
+    victim->dir->FetchFrom(victim->file);
+    victim->lastUse = ++dirClock;
+    return victim;
+}
+
+void
+FileSystem::DropDirectory(unsigned sector)
+{
+    for (unsigned i = 0; i < DIRECTORY_CACHE_SIZE; i++) {
+        CachedDirectory *d = &dirCache[i];
+        if (d->sector == sector) {
+            delete d->dir;
+            delete d->file;
+            d->sector = 0;
+        }
+    }
+}
+
+bool
+FileSystem::SaveDirectory(CachedDirectory *d)
+{
+    ASSERT(d != nullptr);
+
+    bool success = d->dir->WriteBack(d->file);
+    d->file->FlushHeader();  // In case the directory grew.
+    return success;
+}
+
+FileSystem::CachedDirectory *
+FileSystem::Resolve(const char *path, char *name)
+{
+    ASSERT(path != nullptr);
+    ASSERT(name != nullptr);
+
+    CachedDirectory *d = &root;
+    const char *p = path;
+    for (;;) {
+        while (*p == '/') {
+            p++;
+        }
+        const char *end = p;
+        while (*end != '\0' && *end != '/') {
+            end++;
+        }
+        unsigned length = end - p;
+        if (length == 0 || length > FILE_NAME_MAX_LEN) {
+            return nullptr;
+        }
+        memcpy(name, p, length);
+        name[length] = '\0';
+
+        const char *next = end;
+        while (*next == '/') {
+            next++;
+        }
+        if (*next == '\0') {
+            return d;  // `name` is the last one.
+        }
+
+        bool isDirectory;
+        int sector = d->dir->Find(name, &isDirectory);
+        if (sector == -1 || !isDirectory) {
+            return nullptr;
+        }
+        d = GetDirectory(sector);
+        p = next;
+    }
+}
+
+FileSystem::CachedDirectory *
+FileSystem::ResolveDirectory(const char *path)
+{
+    ASSERT(path != nullptr);
+
+    const char *p = path;
+    while (*p == '/') {
+        p++;
+    }
+    if (*p == '\0') {
+        return &root;
+    }
+
+    char name[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(path, name);
+    if (parent == nullptr) {
+        return nullptr;
+    }
+    bool isDirectory;
+    int sector = parent->dir->Find(name, &isDirectory);
+    if (sector == -1 || !isDirectory) {
+        return nullptr;
+    }
+    return GetDirectory(sector);
+}
+
+/// Add a new file or directory to `parent`.
 ///
-/// The steps to create a file are:
-/// 1. Make sure the file does not already exist.
+/// The steps are:
+/// 1. Make sure the name is not taken.
 /// 2. Allocate a sector for the file header.
 /// 3. Allocate space on disk for the data blocks for the file.
-/// 4. Add the name to the directory.
-/// 5. Store the new file header on disk.
-/// 6. Flush the changes to the bitmap and the directory back to disk.
+/// 4. Flush the bitmap and store the new file header on disk.
+/// 5. For a directory, write an empty table into it.
+/// 6. Add the name to the parent directory and flush it.
+///
+/// The cache writes sectors back in this order, so the sectors are marked
+/// used before the header points to them, and the header is complete
+/// before a directory names it.  The free map lock is let go before the
+/// parent is written, since the parent may have to grow.
+bool
+FileSystem::CreateEntry(CachedDirectory *parent, const char *name,
+                        unsigned initialSize, bool isDirectory)
+{
+    ASSERT(parent != nullptr);
+    ASSERT(name != nullptr);
+
+    if (parent->dir->Find(name) != -1) {
+        return false;  // Name is already in directory.
+    }
+
+    freeMapLock->Acquire();
+    int sector = freeMap->Find();
+      // Find a sector to hold the file header.
+    if (sector == -1) {
+        freeMapLock->Release();
+        return false;  // No free block for file header.
+    }
+    FileHeader *h = new FileHeader;
+    if (!h->Allocate(freeMap, initialSize)) {
+        // Fails if no space on disk for data; `Allocate` takes nothing
+        // then.
+        freeMap->Clear(sector);
+        freeMapLock->Release();
+        delete h;
+        return false;
+    }
+    freeMap->WriteBack(freeMapFile);
+    freeMapLock->Release();
+    h->WriteBack(sector);
+
+    bool success = true;
+    if (isDirectory) {
+        OpenFile *file = new OpenFile(sector);
+        Directory *dir = new Directory(NUM_DIR_ENTRIES);
+        success = dir->WriteBack(file);
+        delete dir;
+        delete file;
+    }
+    if (success) {
+        parent->dir->Add(name, sector, isDirectory);
+        success = SaveDirectory(parent);
+        if (!success) {
+            // No room for the parent to grow.
+            parent->dir->Remove(name);
+            SaveDirectory(parent);
+        }
+    }
+    if (!success) {
+        freeMapLock->Acquire();
+        h->Deallocate(freeMap);
+        freeMap->Clear(sector);
+        freeMap->WriteBack(freeMapFile);
+        freeMapLock->Release();
+    }
+    delete h;
+    return success;
+}
+
+/// Take an entry out of `parent` and free its sectors.  If the file is
+/// open, its sectors are freed when the last opener closes it, as in UNIX.
+///
+/// The entry is unlinked before its sectors are released, so that they are
+/// never free on disk while a directory still leads to them.
+void
+FileSystem::RemoveEntry(CachedDirectory *parent, const char *name,
+                        unsigned sector)
+{
+    ASSERT(parent != nullptr);
+    ASSERT(name != nullptr);
+
+    parent->dir->Remove(name);
+    SaveDirectory(parent);
+
+    if (!fileNodeTable->MarkRemoved(sector)) {
+        FileHeader *fileH = new FileHeader;
+        fileH->FetchFrom(sector);
+        Free(fileH, sector);
+        delete fileH;
+    }
+}
+
+void
+FileSystem::Free(FileHeader *hdr, unsigned sector)
+{
+    ASSERT(hdr != nullptr);
+
+    freeMapLock->Acquire();
+    hdr->Deallocate(freeMap);  // Remove data blocks.
+    freeMap->Clear(sector);    // Remove header block.
+    freeMap->WriteBack(freeMapFile);
+    freeMapLock->Release();
+}
+
+/// Create a file in the Nachos file system (similar to UNIX `create`).
+/// Files grow as they are written, but `Create` can be given an initial
+/// size to allocate up front.
 ///
 /// Return true if everything goes ok, otherwise, return false.
 ///
 /// Create fails if:
-/// * file is already in directory;
+/// * a directory in the path does not exist;
+/// * file is already in its directory;
 /// * no free space for file header;
-/// * no free entry for file in directory;
+/// * no room for the directory to grow;
 /// * no free space for data blocks for the file.
 ///
-/// Note that this implementation assumes there is no concurrent access to
-/// the file system!
-///
-/// * `name` is the name of file to be created.
+/// * `name` is the path of the file to be created.
 /// * `initialSize` is the size of file to be created.
 bool
 FileSystem::Create(const char *name, unsigned initialSize)
@@ -171,116 +423,213 @@ FileSystem::Create(const char *name, unsigned initialSize)
 
     DEBUG('f', "Creating file %s, size %u\n", name, initialSize);
 
-    Directory *dir = new Directory(NUM_DIR_ENTRIES);
-    dir->FetchFrom(directoryFile);
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    bool success = parent != nullptr
+                   && CreateEntry(parent, base, initialSize, false);
+    directoryLock->Release();
+    return success;
+}
 
-    bool success;
+/// Create an empty directory.  It fails for the same reasons as `Create`.
+///
+/// * `name` is the path of the directory to be created.
+bool
+FileSystem::Mkdir(const char *name)
+{
+    ASSERT(name != nullptr);
 
-    if (dir->Find(name) != -1) {
-        success = false;  // File is already in directory.
-    } else {
-        Bitmap *freeMap = new Bitmap(NUM_SECTORS);
-        freeMap->FetchFrom(freeMapFile);
-        int sector = freeMap->Find();
-          // Find a sector to hold the file header.
-        if (sector == -1) {
-            success = false;  // No free block for file header.
-        } else if (!dir->Add(name, sector)) {
-            success = false;  // No space in directory.
-        } else {
-            FileHeader *h = new FileHeader;
-            success = h->Allocate(freeMap, initialSize);
-              // Fails if no space on disk for data.
-            if (success) {
-                // Everything worked, flush all changes back to disk.
-                h->WriteBack(sector);
-                dir->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
-            }
-            delete h;
-        }
-        delete freeMap;
-    }
-    delete dir;
+    DEBUG('f', "Creating directory %s\n", name);
+
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    bool success = parent != nullptr
+                   && CreateEntry(parent, base, DIRECTORY_FILE_SIZE, true);
+    directoryLock->Release();
     return success;
 }
 
 /// Open a file for reading and writing.
 ///
 /// To open a file:
-/// 1. Find the location of the file's header, using the directory.
+/// 1. Find the location of the file's header, following the path through
+///    the directories.
 /// 2. Bring the header into memory.
 ///
-/// * `name` is the text name of the file to be opened.
+/// Directories cannot be opened.
+///
+/// * `name` is the path of the file to be opened.
 OpenFile *
 FileSystem::Open(const char *name)
 {
     ASSERT(name != nullptr);
 
-    Directory *dir = new Directory(NUM_DIR_ENTRIES);
-    OpenFile  *openFile = nullptr;
+    OpenFile *openFile = nullptr;
 
     DEBUG('f', "Opening file %s\n", name);
-    dir->FetchFrom(directoryFile);
-    int sector = dir->Find(name);
-    if (sector >= 0) {
-        openFile = new OpenFile(sector);  // `name` was found in directory.
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    if (parent != nullptr) {
+        bool isDirectory;
+        int sector = parent->dir->Find(base, &isDirectory);
+        if (sector >= 0 && !isDirectory) {
+            openFile = new OpenFile(sector);  // `name` was found.
+        }
     }
-    delete dir;
+    directoryLock->Release();
     return openFile;  // Return null if not found.
 }
 
+int
+FileSystem::Find(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    int sector = -1;
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    if (parent != nullptr) {
+        bool isDirectory = false;
+        sector = parent->dir->Find(base, &isDirectory);
+        if (isDirectory) {
+            sector = -1;
+        }
+    }
+    directoryLock->Release();
+    return sector;
+}
+
 /// Delete a file from the file system.
 ///
 /// This requires:
-/// 1. Remove it from the directory.
+/// 1. Remove it from its directory.
 /// 2. Delete the space for its header.
 /// 3. Delete the space for its data blocks.
 /// 4. Write changes to directory, bitmap back to disk.
 ///
 /// Return true if the file was deleted, false if the file was not in the
-/// file system.
+/// file system or is a directory.
 ///
-/// * `name` is the text name of the file to be removed.
+/// * `name` is the path of the file to be removed.
 bool
 FileSystem::Remove(const char *name)
 {
     ASSERT(name != nullptr);
 
-    Directory *dir = new Directory(NUM_DIR_ENTRIES);
-    dir->FetchFrom(directoryFile);
-    int sector = dir->Find(name);
-    if (sector == -1) {
-       delete dir;
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    bool isDirectory;
+    int sector = parent != nullptr ? parent->dir->Find(base, &isDirectory)
+                                   : -1;
+    if (sector == -1 || isDirectory) {
+       directoryLock->Release();
        return false;  // file not found
     }
-    FileHeader *fileH = new FileHeader;
-    fileH->FetchFrom(sector);
+    RemoveEntry(parent, base, sector);
+    directoryLock->Release();
+    return true;
+}
 
-    Bitmap *freeMap = new Bitmap(NUM_SECTORS);
-    freeMap->FetchFrom(freeMapFile);
+/// Delete a directory.  Return false if it does not exist, is not empty,
+/// or is the root.
+///
+/// * `name` is the path of the directory to be removed.
+bool
+FileSystem::Rmdir(const char *name)
+{
+    ASSERT(name != nullptr);
 
-    fileH->Deallocate(freeMap);  // Remove data blocks.
-    freeMap->Clear(sector);      // Remove header block.
-    dir->Remove(name);
+    DEBUG('f', "Removing directory %s\n", name);
+
+    directoryLock->Acquire();
+    char base[FILE_NAME_MAX_LEN + 1];
+    CachedDirectory *parent = Resolve(name, base);
+    bool isDirectory = false;
+    int sector = parent != nullptr ? parent->dir->Find(base, &isDirectory)
+                                   : -1;
+    bool success = sector != -1 && isDirectory
+                   && GetDirectory(sector)->dir->IsEmpty();
+    if (success) {
+        DropDirectory(sector);
+        RemoveEntry(parent, base, sector);
+    }
+    directoryLock->Release();
+    return success;
+}
 
-    freeMap->WriteBack(freeMapFile);  // Flush to disk.
-    dir->WriteBack(directoryFile);    // Flush to disk.
-    delete fileH;
-    delete dir;
-    delete freeMap;
-    return true;
+int
+FileSystem::ListDir(const char *name, char *buffer, unsigned size)
+{
+    ASSERT(name != nullptr);
+    ASSERT(buffer != nullptr);
+
+    directoryLock->Acquire();
+    CachedDirectory *d = ResolveDirectory(name);
+    if (d == nullptr) {
+        directoryLock->Release();
+        return -1;
+    }
+
+    const RawDirectory *raw = d->dir->GetRaw();
+    unsigned used = 0;
+    bool full = false;
+    for (unsigned i = 0; i < raw->tableSize; i++) {
+        const DirectoryEntry *e = &raw->table[i];
+        if (!e->inUse) {
+            continue;
+        }
+        unsigned length = strlen(e->name);
+        unsigned needed = length + (e->isDirectory ? 2 : 1);
+        full = full || used + needed > size;
+        if (full) {
+            used += needed;  // Only count what the whole listing takes.
+            continue;
+        }
+        memcpy(&buffer[used], e->name, length);
+        used += length;
+        if (e->isDirectory) {
+            buffer[used++] = '/';
+        }
+        buffer[used++] = '\n';
+    }
+    directoryLock->Release();
+    return used;
 }
 
-/// List all the files in the file system directory.
+/// Grow a file, taking sectors from the free map.  The free map is written
+/// before the header, so the new sectors are never both in the file and
+/// free on disk.
+///
+/// * `hdr` is the in-memory header of the file.
+/// * `sector` is where `hdr` is stored.
+/// * `newSize` is the length the file must reach.
+bool
+FileSystem::Extend(FileHeader *hdr, unsigned sector, unsigned newSize)
+{
+    ASSERT(hdr != nullptr);
+
+    freeMapLock->Acquire();
+    bool success = hdr->Extend(freeMap, newSize);
+    if (success) {
+        freeMap->WriteBack(freeMapFile);
+        hdr->WriteBack(sector);
+    }
+    freeMapLock->Release();
+    return success;
+}
+
+/// List all the files in the root directory.
 void
 FileSystem::List()
 {
-    Directory *dir = new Directory(NUM_DIR_ENTRIES);
-
-    dir->FetchFrom(directoryFile);
-    dir->List();
-    delete dir;
+    directoryLock->Acquire();
+    directory->List();
+    directoryLock->Release();
 }
 
 static bool
@@ -318,10 +667,11 @@ CheckSector(unsigned sector, Bitmap *shadowMap)
 }
 
 static bool
-CheckFileHeader(const RawFileHeader *rh, unsigned num, Bitmap *shadowMap)
+CheckFileHeader(const FileHeader *h, unsigned num, Bitmap *shadowMap)
 {
-    ASSERT(rh != nullptr);
+    ASSERT(h != nullptr);
 
+    const RawFileHeader *rh = h->GetRaw();
     bool error = false;
 
     DEBUG('f', "Checking file header %u.  File size: %u bytes, number of sectors: %u.\n",
@@ -329,11 +679,16 @@ CheckFileHeader(const RawFileHeader *rh, unsigned num, Bitmap *shadowMap)
     error |= CheckForError(rh->numSectors >= DivRoundUp(rh->numBytes,
                                                         SECTOR_SIZE),
                            "sector count not compatible with file size.");
-    error |= CheckForError(rh->numSectors < NUM_DIRECT,
-                           "too many blocks.");
+    if (CheckForError(rh->numSectors <= MAX_FILE_SECTORS,
+                      "too many blocks.")) {
+        return true;
+    }
+    for (unsigned i = 0; i < h->NumIndexSectors(); i++) {
+        DEBUG('f', "Checking index block %u.\n", h->IndexSector(i));
+        error |= CheckSector(h->IndexSector(i), shadowMap);
+    }
     for (unsigned i = 0; i < rh->numSectors; i++) {
-        unsigned s = rh->dataSectors[i];
-        error |= CheckSector(s, shadowMap);
+        error |= CheckSector(h->DataSector(i), shadowMap);
     }
     return error;
 }
@@ -351,6 +706,9 @@ CheckBitmaps(const Bitmap *freeMap, const Bitmap *shadowMap)
     return error;
 }
 
+static bool CheckSubdirectory(const FileHeader *h, unsigned sector,
+                              Bitmap *shadowMap);
+
 static bool
 CheckDirectory(const RawDirectory *rd, Bitmap *shadowMap)
 {
@@ -359,9 +717,9 @@ CheckDirectory(const RawDirectory *rd, Bitmap *shadowMap)
 
     bool error = false;
     unsigned nameCount = 0;
-    const char *knownNames[NUM_DIR_ENTRIES];
+    const char **knownNames = new const char * [rd->tableSize];
 
-    for (unsigned i = 0; i < NUM_DIR_ENTRIES; i++) {
+    for (unsigned i = 0; i < rd->tableSize; i++) {
         DEBUG('f', "Checking direntry: %u.\n", i);
         const DirectoryEntry *e = &rd->table[i];
 
@@ -390,17 +748,42 @@ CheckDirectory(const RawDirectory *rd, Bitmap *shadowMap)
                 nameCount++;
             }
 
-            // Check sector.
-            error |= CheckSector(e->sector, shadowMap);
+            // Check sector.  A sector seen before means a loop or a shared
+            // header, so it is not followed again.
+            bool sectorError = CheckSector(e->sector, shadowMap);
+            error |= sectorError;
 
             // Check file header.
             FileHeader *h = new FileHeader;
-            const RawFileHeader *rh = h->GetRaw();
             h->FetchFrom(e->sector);
-            error |= CheckFileHeader(rh, e->sector, shadowMap);
+            error |= CheckFileHeader(h, e->sector, shadowMap);
+            if (e->isDirectory && !sectorError) {
+                error |= CheckSubdirectory(h, e->sector, shadowMap);
+            }
             delete h;
         }
     }
+    delete [] knownNames;
+    return error;
+}
+
+static bool
+CheckSubdirectory(const FileHeader *h, unsigned sector, Bitmap *shadowMap)
+{
+    ASSERT(h != nullptr);
+
+    DEBUG('f', "Checking directory at sector %u.\n", sector);
+    if (CheckForError(h->FileLength() >= sizeof (DirectoryEntry)
+                        && h->GetRaw()->numSectors <= MAX_FILE_SECTORS,
+                      "bad directory header.")) {
+        return true;
+    }
+    OpenFile *file = new OpenFile(sector);
+    Directory *dir = new Directory(NUM_DIR_ENTRIES);
+    dir->FetchFrom(file);
+    bool error = CheckDirectory(dir->GetRaw(), shadowMap);
+    delete dir;
+    delete file;
     return error;
 }
 
@@ -427,30 +810,30 @@ FileSystem::Check()
                            "bad bitmap header: wrong file size.");
     error |= CheckForError(bitRH->numSectors == FREE_MAP_FILE_SIZE / SECTOR_SIZE,
                            "bad bitmap header: wrong number of sectors.");
-    error |= CheckFileHeader(bitRH, FREE_MAP_SECTOR, shadowMap);
+    error |= CheckFileHeader(bitH, FREE_MAP_SECTOR, shadowMap);
     delete bitH;
 
     DEBUG('f', "Checking directory.\n");
 
     FileHeader *dirH = new FileHeader;
-    const RawFileHeader *dirRH = dirH->GetRaw();
     dirH->FetchFrom(DIRECTORY_SECTOR);
-    error |= CheckFileHeader(dirRH, DIRECTORY_SECTOR, shadowMap);
+    error |= CheckFileHeader(dirH, DIRECTORY_SECTOR, shadowMap);
     delete dirH;
 
-    Bitmap *freeMap = new Bitmap(NUM_SECTORS);
-    freeMap->FetchFrom(freeMapFile);
-    Directory *dir = new Directory(NUM_DIR_ENTRIES);
-    const RawDirectory *rdir = dir->GetRaw();
-    dir->FetchFrom(directoryFile);
-    error |= CheckDirectory(rdir, shadowMap);
-    delete dir;
+    // The free map and the directories are checked as they are in memory,
+    // since their sectors on disk may not be up to date.  The free map lock
+    // is only taken once the directories have been walked, since opening a
+    // subdirectory takes locks that come before it.
+    directoryLock->Acquire();
+    error |= CheckDirectory(directory->GetRaw(), shadowMap);
 
     // The two bitmaps should match.
     DEBUG('f', "Checking bitmap consistency.\n");
+    freeMapLock->Acquire();
     error |= CheckBitmaps(freeMap, shadowMap);
+    freeMapLock->Release();
+    directoryLock->Release();
     delete shadowMap;
-    delete freeMap;
 
     DEBUG('f', error ? "Filesystem check failed.\n"
                      : "Filesystem check succeeded.\n");
@@ -467,10 +850,8 @@ FileSystem::Check()
 void
 FileSystem::Print()
 {
-    FileHeader *bitH    = new FileHeader;
-    FileHeader *dirH    = new FileHeader;
-    Bitmap     *freeMap = new Bitmap(NUM_SECTORS);
-    Directory  *dir     = new Directory(NUM_DIR_ENTRIES);
+    FileHeader *bitH = new FileHeader;
+    FileHeader *dirH = new FileHeader;
 
     printf("--------------------------------\n");
     bitH->FetchFrom(FREE_MAP_SECTOR);
@@ -481,16 +862,16 @@ FileSystem::Print()
     dirH->Print("Directory");
 
     printf("--------------------------------\n");
-    freeMap->FetchFrom(freeMapFile);
+    freeMapLock->Acquire();
     freeMap->Print();
+    freeMapLock->Release();
 
     printf("--------------------------------\n");
-    dir->FetchFrom(directoryFile);
-    dir->Print();
+    directoryLock->Acquire();
+    directory->Print();
+    directoryLock->Release();
     printf("--------------------------------\n");
 
     delete bitH;
     delete dirH;
-    delete freeMap;
-    delete dir;
 }
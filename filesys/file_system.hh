@@ -87,6 +87,27 @@ public:
         return SystemDep::Unlink(name) == 0;
     }
 
+    /// Directories are not supported by the stub.
+
+    bool Mkdir(const char *name)
+    {
+        ASSERT(name != nullptr);
+        return false;
+    }
+
+    bool Rmdir(const char *name)
+    {
+        ASSERT(name != nullptr);
+        return false;
+    }
+
+    int ListDir(const char *name, char *buffer, unsigned size)
+    {
+        ASSERT(name != nullptr);
+        ASSERT(buffer != nullptr);
+        return -1;
+    }
+
 };
 
 #else  // FILESYS
@@ -96,11 +117,19 @@ public:
 #include "machine/disk.hh"
 
 
-/// Initial file sizes for the bitmap and directory; until the file system
-/// supports extensible files, the directory size sets the maximum number of
-/// files that can be loaded onto the disk.
+class Bitmap;
+class Directory;
+class FileHeader;
+class Lock;
+
+
+/// Initial file sizes for the bitmap and directories; directories grow as
+/// entries are added.
 static const unsigned FREE_MAP_FILE_SIZE = NUM_SECTORS / BITS_IN_BYTE;
 static const unsigned NUM_DIR_ENTRIES = 10;
+
+/// Number of directories other than the root kept in memory.
+static const unsigned DIRECTORY_CACHE_SIZE = 8;
 static const unsigned DIRECTORY_FILE_SIZE
   = sizeof (DirectoryEntry) * NUM_DIR_ENTRIES;
 
@@ -117,16 +146,45 @@ public:
 
     ~FileSystem();
 
+    /// Files and directories are named by paths: names separated by `/`,
+    /// starting from the root directory.  A leading `/` is optional.
+
     /// Create a file (UNIX `creat`).
     bool Create(const char *name, unsigned initialSize);
 
     /// Open a file (UNIX `open`).
     OpenFile *Open(const char *name);
 
+    /// Return the header sector of the file `name`, or -1 if there is no
+    /// such file.  Every path naming the file gives the same sector.
+    int Find(const char *name);
+
     /// Delete a file (UNIX `unlink`).
     bool Remove(const char *name);
 
-    /// List all the files in the file system.
+    /// Create an empty directory (UNIX `mkdir`).
+    bool Mkdir(const char *name);
+
+    /// Delete an empty directory (UNIX `rmdir`).
+    bool Rmdir(const char *name);
+
+    /// Copy the names in directory `name` into `buffer`, one per line;
+    /// names of directories end in `/`.  Return the number of bytes the
+    /// whole listing takes, or -1 if `name` is not a directory.  If that is
+    /// more than `size`, the listing stops before the first name that does
+    /// not fit.
+    int ListDir(const char *name, char *buffer, unsigned size);
+
+    /// Make the file whose header `hdr` is stored at `sector` `newSize`
+    /// bytes long, allocating sectors for it.  Return false if there is no
+    /// space left.
+    bool Extend(FileHeader *hdr, unsigned sector, unsigned newSize);
+
+    /// Give the header sector and the data sectors of a removed file back
+    /// to the free map.
+    void Free(FileHeader *hdr, unsigned sector);
+
+    /// List all the files in the root directory.
     void List();
 
     /// Check the filesystem.
@@ -136,10 +194,54 @@ public:
     void Print();
 
 private:
+    /// A directory kept in memory, with the open file holding it.
+    struct CachedDirectory {
+        unsigned sector;  ///< Header sector; 0 if the slot is free.
+        OpenFile *file;
+        Directory *dir;
+        unsigned long lastUse;
+    };
+
+    /// Return the directory whose header is at `sector`, reading it in if
+    /// it is not cached.
+    CachedDirectory *GetDirectory(unsigned sector);
+
+    /// Forget the cached copy of the directory at `sector`, if any.
+    void DropDirectory(unsigned sector);
+
+    /// Write the changed parts of a directory back to disk.
+    bool SaveDirectory(CachedDirectory *d);
+
+    /// Find the directory that holds the last name in `path`, and copy that
+    /// name into `name`.  Return null if a directory on the way does not
+    /// exist or a name is too long.
+    CachedDirectory *Resolve(const char *path, char *name);
+
+    /// Find the directory named by `path`, or return null.
+    CachedDirectory *ResolveDirectory(const char *path);
+
+    /// Allocate a header and `initialSize` bytes, and add them to `parent`
+    /// under `name`.  New directories get an empty table.
+    bool CreateEntry(CachedDirectory *parent, const char *name,
+                     unsigned initialSize, bool isDirectory);
+
+    /// Take `name`, whose header is at `sector`, out of `parent` and free
+    /// its sectors.
+    void RemoveEntry(CachedDirectory *parent, const char *name,
+                     unsigned sector);
+
     OpenFile *freeMapFile;  ///< Bit map of free disk blocks, represented as a
                             ///< file.
     OpenFile *directoryFile;  ///< “Root” directory -- list of file names,
                               ///< represented as a file.
+    Bitmap *freeMap;  ///< Contents of `freeMapFile`.
+    Directory *directory;  ///< Contents of `directoryFile`.
+    CachedDirectory root;  ///< The two above, as a cached directory.
+    CachedDirectory dirCache[DIRECTORY_CACHE_SIZE];
+    unsigned long dirClock;  ///< Source of `lastUse` values.
+    Lock *freeMapLock;  ///< Protects `freeMap`.
+    Lock *directoryLock;  ///< Protects all directories; taken before
+                          ///< `freeMapLock` when both are needed.
 };
 
 #endif
@@ -3,7 +3,18 @@
 /// (in Nachos, by deleting the `OpenFile` data structure).
 ///
 /// Also as in UNIX, for convenience, we keep the file header in memory while
-/// the file is open.
+/// the file is open, in a single copy shared by everyone who has it open
+/// (cf. `file_node_table.hh`).  Writing past the end of the file makes it
+/// grow.  When that only changes its length, the header is written back
+/// when the last opener closes the file rather than on every write.
+///
+/// Reads of a file may go on at the same time, but a write has the file to
+/// itself.
+///
+/// Reads that go through the file in order make the following sectors be
+/// prefetched into the disk cache.  The number of sectors kept ahead
+/// doubles as long as access stays sequential, and drops to none as soon
+/// as it does not.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
@@ -13,26 +24,32 @@
 
 #include "open_file.hh"
 #include "file_header.hh"
+#include "file_node_table.hh"
+#include "file_system.hh"
+#include "synch_disk.hh"
+#include "threads/rw_lock.hh"
 #include "threads/system.hh"
 
 #include <string.h>
 
 
 /// Open a Nachos file for reading and writing.  Bring the file header into
-/// memory while the file is open.
+/// memory while the file is open, unless it is open already.
 ///
 /// * `sector` is the location on disk of the file header for this file.
 OpenFile::OpenFile(int sector)
 {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    node = fileNodeTable->Get(sector);
     seekPosition = 0;
+    lastReadSector = -1;
+    readAheadWindow = 0;
+    readAheadEnd = 0;
 }
 
 /// Close a Nachos file, de-allocating any in-memory data structures.
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    fileNodeTable->Release(node);
 }
 
 /// Change the current location within the open file -- the point at which
@@ -110,6 +127,16 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
     ASSERT(into != nullptr);
     ASSERT(numBytes > 0);
 
+    node->lock->AcquireRead();
+    int result = ReadLocked(into, numBytes, position);
+    node->lock->ReleaseRead();
+    return result;
+}
+
+int
+OpenFile::ReadLocked(char *into, unsigned numBytes, unsigned position)
+{
+    FileHeader *hdr = node->hdr;
     unsigned fileLength = hdr->FileLength();
     unsigned firstSector, lastSector, numSectors;
     char *buf;
@@ -137,20 +164,89 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
     // Copy the part we want.
     memcpy(into, &buf[position - firstSector * SECTOR_SIZE], numBytes);
     delete [] buf;
+
+    ReadAhead(firstSector, lastSector);
     return numBytes;
 }
 
+void
+OpenFile::ReadAhead(unsigned firstSector, unsigned lastSector)
+{
+    // Reading the sector just read again, or the one after, is sequential;
+    // small reads stay in the same sector many times in a row.
+    if (firstSector == (unsigned) (lastReadSector + 1)) {
+        readAheadWindow = readAheadWindow == 0 ? READ_AHEAD_MIN
+                                               : 2 * readAheadWindow;
+        if (readAheadWindow > READ_AHEAD_MAX) {
+            readAheadWindow = READ_AHEAD_MAX;
+        }
+    } else if (firstSector != (unsigned) lastReadSector) {
+        readAheadWindow = 0;
+        readAheadEnd = 0;
+    }
+    lastReadSector = lastSector;
+    if (readAheadWindow == 0) {
+        return;
+    }
+
+    FileHeader *hdr = node->hdr;
+    unsigned numSectors = DivRoundUp(hdr->FileLength(), SECTOR_SIZE);
+    unsigned from = lastSector + 1 > readAheadEnd ? lastSector + 1
+                                                  : readAheadEnd;
+    unsigned to = lastSector + 1 + readAheadWindow;
+    if (to > numSectors) {
+        to = numSectors;
+    }
+    // Stop at the first request the queue cannot take, so that it is
+    // asked for again on the next read.
+    unsigned i = from;
+    while (i < to && synchDisk->Prefetch(hdr->ByteToSector(i * SECTOR_SIZE))) {
+        i++;
+    }
+    if (i > readAheadEnd) {
+        readAheadEnd = i;
+    }
+}
+
 int
 OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
 {
     ASSERT(from != nullptr);
     ASSERT(numBytes > 0);
 
+    node->lock->AcquireWrite();
+    int result = WriteLocked(from, numBytes, position);
+    node->lock->ReleaseWrite();
+    return result;
+}
+
+int
+OpenFile::WriteLocked(const char *from, unsigned numBytes, unsigned position)
+{
+    FileHeader *hdr = node->hdr;
     unsigned fileLength = hdr->FileLength();
     unsigned firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
     char *buf;
 
+    unsigned oldLength = fileLength;
+    if (position + numBytes > fileLength) {
+        if (position > fileLength) {
+            // Fill the hole with zeros, as UNIX does.
+            char zeros[SECTOR_SIZE] = {};
+            while (fileLength < position) {
+                unsigned n = position - fileLength < SECTOR_SIZE
+                             ? position - fileLength : SECTOR_SIZE;
+                if (WriteLocked(zeros, n, fileLength) != (int) n) {
+                    return 0;
+                }
+                fileLength = hdr->FileLength();
+            }
+            oldLength = fileLength;
+        }
+        Grow(position + numBytes);
+        fileLength = hdr->FileLength();
+    }
     if (position >= fileLength) {
         return 0;  // Check request.
     }
@@ -170,12 +266,23 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     lastAligned  = position + numBytes == (lastSector + 1) * SECTOR_SIZE;
 
     // Read in first and last sector, if they are to be partially modified.
+    // Sectors past the old end of the file hold nothing worth reading.
     if (!firstAligned) {
-        ReadAt(buf, SECTOR_SIZE, firstSector * SECTOR_SIZE);
+        if (firstSector * SECTOR_SIZE < oldLength) {
+            synchDisk->ReadSector(hdr->ByteToSector(firstSector * SECTOR_SIZE),
+                                  buf);
+        } else {
+            memset(buf, 0, SECTOR_SIZE);
+        }
     }
     if (!lastAligned && (firstSector != lastSector || firstAligned)) {
-        ReadAt(&buf[(lastSector - firstSector) * SECTOR_SIZE],
-               SECTOR_SIZE, lastSector * SECTOR_SIZE);
+        char *last = &buf[(lastSector - firstSector) * SECTOR_SIZE];
+        if (lastSector * SECTOR_SIZE < oldLength) {
+            synchDisk->ReadSector(hdr->ByteToSector(lastSector * SECTOR_SIZE),
+                                  last);
+        } else {
+            memset(last, 0, SECTOR_SIZE);
+        }
     }
 
     // Copy in the bytes we want to change.
@@ -190,9 +297,40 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     return numBytes;
 }
 
+bool
+OpenFile::Grow(unsigned newLength)
+{
+    if (node->hdr->GrowInPlace(newLength)) {
+        node->hdrDirty = true;
+        return true;
+    }
+    if (fileSystem->Extend(node->hdr, node->sector, newLength)) {
+        node->hdrDirty = false;  // Written along with the free map.
+        return true;
+    }
+    return false;
+}
+
+void
+OpenFile::FlushHeader()
+{
+    node->lock->AcquireWrite();
+    if (node->hdrDirty) {
+        node->hdr->WriteBack(node->sector);
+        node->hdrDirty = false;
+    }
+    node->lock->ReleaseWrite();
+}
+
 /// Return the number of bytes in the file.
 unsigned
 OpenFile::Length() const
 {
-    return hdr->FileLength();
+    return node->hdr->FileLength();
+}
+
+unsigned
+OpenFile::GetSector() const
+{
+    return node->sector;
 }
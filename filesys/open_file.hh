@@ -85,7 +85,13 @@ private:
 };
 
 #else // FILESYS
-class FileHeader;
+struct FileNode;
+
+/// Number of sectors read ahead when sequential access starts.
+const unsigned READ_AHEAD_MIN = 2;
+
+/// Most sectors read ahead of a sequential reader.
+const unsigned READ_AHEAD_MAX = 16;
 
 class OpenFile {
 public:
@@ -114,9 +120,33 @@ public:
     // the UNIX idiom -- `lseek` to end of file, `tell`, `lseek` back).
     unsigned Length() const;
 
+    /// Return the sector of the file header, which tells the file apart
+    /// whatever path it was opened through.
+    unsigned GetSector() const;
+
+    /// Write the header back if it changed, without waiting for the file
+    /// to be closed.
+    void FlushHeader();
+
   private:
-    FileHeader *hdr;  ///< Header for this file.
+    /// `ReadAt` and `WriteAt`, for a caller holding the file's lock.
+    int ReadLocked(char *into, unsigned numBytes, unsigned position);
+    int WriteLocked(const char *from, unsigned numBytes, unsigned position);
+
+    /// Make the file at least `newLength` bytes long.  Return false if
+    /// there is no room.
+    bool Grow(unsigned newLength);
+
+    /// Prefetch the sectors following a read of sectors `firstSector` to
+    /// `lastSector`, if reads have been sequential so far.
+    void ReadAhead(unsigned firstSector, unsigned lastSector);
+
+    FileNode *node;  ///< Header for this file, shared with other openers.
     unsigned seekPosition;  ///< Current position within the file.
+    int lastReadSector;     ///< Last sector read, or -1.
+    unsigned readAheadWindow;  ///< Sectors to keep ahead of the reader; 0
+                               ///< while access is not sequential.
+    unsigned readAheadEnd;  ///< First sector not prefetched yet.
 };
 
 #endif
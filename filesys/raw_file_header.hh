@@ -11,14 +11,35 @@
 
 
 static const unsigned NUM_DIRECT
-  = (SECTOR_SIZE - 2 * sizeof (int)) / sizeof (int);
-const unsigned MAX_FILE_SIZE = NUM_DIRECT * SECTOR_SIZE;
+  = (SECTOR_SIZE - 4 * sizeof (int)) / sizeof (int);
 
+/// Number of sector numbers held by an index block.
+static const unsigned NUM_INDIRECT = SECTOR_SIZE / sizeof (int);
+
+const unsigned MAX_FILE_SECTORS
+  = NUM_DIRECT + NUM_INDIRECT + NUM_INDIRECT * NUM_INDIRECT;
+const unsigned MAX_FILE_SIZE = MAX_FILE_SECTORS * SECTOR_SIZE;
+
+/// Most sectors allocated ahead of need when a file grows.  A file gets as
+/// many spare sectors as it already has, up to this many.
+const unsigned MAX_PREALLOCATED_SECTORS = 16;
+
+/// The first `NUM_DIRECT` data sectors of a file are listed in the header.
+/// The next `NUM_INDIRECT` are listed in the single indirect block, and the
+/// rest in the blocks listed by the double indirect block.  Index blocks
+/// that are not needed are not allocated, and their fields are 0.
 struct RawFileHeader {
     unsigned numBytes;  ///< Number of bytes in the file.
     unsigned numSectors;  ///< Number of data sectors in the file.
     unsigned dataSectors[NUM_DIRECT];  ///< Disk sector numbers for each data
                                        ///< block in the file.
+    unsigned singleIndirect;  ///< Index block of the following sectors.
+    unsigned doubleIndirect;  ///< Index block of index blocks.
+};
+
+/// Contents of an index block.
+struct RawIndexBlock {
+    unsigned sectors[NUM_INDIRECT];
 };
 
 
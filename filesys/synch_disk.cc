@@ -7,6 +7,11 @@
 /// requests.  And, because the physical disk can only handle one operation
 /// at a time, use a lock to enforce mutual exclusion.
 ///
+/// Sectors go through a write-back buffer cache.  Buffers are found through
+/// hash chains, and the least recently used one that nobody is using is the
+/// one reused on a miss.  A daemon thread writes dirty buffers back
+/// periodically, and another one fills buffers asked for by `Prefetch`.
+///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2021 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
@@ -14,6 +19,10 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
+#include "threads/thread.hh"
+
+#include <string.h>
 
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
@@ -26,6 +35,32 @@ DiskRequestDone(void *arg)
     disk->RequestDone();
 }
 
+/// Flush timer interrupt handler.
+static void
+DiskFlushTimer(void *arg)
+{
+    ASSERT(arg != nullptr);
+    SynchDisk *disk = (SynchDisk *) arg;
+    disk->FlushTick();
+    interrupt->Schedule(DiskFlushTimer, arg, FLUSH_INTERVAL, TIMER_INT);
+}
+
+static void
+DiskFlushDaemon(void *arg)
+{
+    ASSERT(arg != nullptr);
+    SynchDisk *disk = (SynchDisk *) arg;
+    disk->FlushDaemon();
+}
+
+static void
+DiskPrefetcher(void *arg)
+{
+    ASSERT(arg != nullptr);
+    SynchDisk *disk = (SynchDisk *) arg;
+    disk->Prefetcher();
+}
+
 /// Initialize the synchronous interface to the physical disk, in turn
 /// initializing the physical disk.
 ///
@@ -36,16 +71,240 @@ SynchDisk::SynchDisk(const char *name)
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
     disk = new Disk(name, DiskRequestDone, this);
+
+    cacheLock = new Lock("disk cache lock");
+    bufferReleased = new Condition("disk buffer released", cacheLock);
+    for (unsigned i = 0; i < CACHE_BUCKETS; i++) {
+        buckets[i] = -1;
+    }
+    lruHead = lruTail = -1;
+    for (unsigned i = 0; i < CACHE_SIZE; i++) {
+        buffers[i].sector = -1;
+        buffers[i].valid = false;
+        buffers[i].dirty = false;
+        buffers[i].users = 0;
+        buffers[i].lock = new Lock("disk buffer lock");
+        buffers[i].hashNext = -1;
+        LruPushFront(i);
+    }
+    numDirty = 0;
+    writeSeq = 0;
+
+    flushNeeded = new Semaphore("disk flush needed", 0);
+    flushRequested = false;
+    Thread *flusher = new Thread("disk flusher", false);
+    flusher->Fork(DiskFlushDaemon, this);
+    interrupt->Schedule(DiskFlushTimer, this, FLUSH_INTERVAL, TIMER_INT);
+
+    prefetchHead = prefetchCount = 0;
+    prefetchNeeded = new Semaphore("disk prefetch needed", 0);
+    Thread *prefetcher = new Thread("disk prefetcher", false);
+    prefetcher->Fork(DiskPrefetcher, this);
 }
 
 /// De-allocate data structures needed for the synchronous disk abstraction.
 SynchDisk::~SynchDisk()
 {
+    for (unsigned i = 0; i < CACHE_SIZE; i++) {
+        delete buffers[i].lock;
+    }
+    delete prefetchNeeded;
+    delete flushNeeded;
+    delete bufferReleased;
+    delete cacheLock;
     delete disk;
     delete lock;
     delete semaphore;
 }
 
+int
+SynchDisk::Lookup(int sector) const
+{
+    for (int i = buckets[sector % CACHE_BUCKETS]; i != -1;
+         i = buffers[i].hashNext) {
+        if (buffers[i].sector == sector) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void
+SynchDisk::HashInsert(int index)
+{
+    int *head = &buckets[buffers[index].sector % CACHE_BUCKETS];
+    buffers[index].hashNext = *head;
+    *head = index;
+}
+
+void
+SynchDisk::HashRemove(int index)
+{
+    for (int *p = &buckets[buffers[index].sector % CACHE_BUCKETS];
+         *p != -1; p = &buffers[*p].hashNext) {
+        if (*p == index) {
+            *p = buffers[index].hashNext;
+            return;
+        }
+    }
+    ASSERT(false);
+}
+
+void
+SynchDisk::LruRemove(int index)
+{
+    Buffer *b = &buffers[index];
+    if (b->lruPrev != -1) {
+        buffers[b->lruPrev].lruNext = b->lruNext;
+    } else {
+        lruHead = b->lruNext;
+    }
+    if (b->lruNext != -1) {
+        buffers[b->lruNext].lruPrev = b->lruPrev;
+    } else {
+        lruTail = b->lruPrev;
+    }
+}
+
+void
+SynchDisk::LruPushFront(int index)
+{
+    Buffer *b = &buffers[index];
+    b->lruPrev = -1;
+    b->lruNext = lruHead;
+    if (lruHead != -1) {
+        buffers[lruHead].lruPrev = index;
+    } else {
+        lruTail = index;
+    }
+    lruHead = index;
+}
+
+SynchDisk::Buffer *
+SynchDisk::GetBuffer(int sector)
+{
+    ASSERT(sector >= 0 && (unsigned) sector < NUM_SECTORS);
+
+    cacheLock->Acquire();
+    int i;
+    for (;;) {
+        if ((i = Lookup(sector)) != -1) {
+            stats->diskCacheHits++;
+            break;
+        }
+        if ((i = PickVictim()) == -1) {
+            bufferReleased->Wait();
+            continue;
+        }
+        if (buffers[i].dirty) {
+            // Write the victim back and look again, since anything may
+            // have happened meanwhile.
+            buffers[i].users++;
+            cacheLock->Release();
+            Clean(&buffers[i]);
+            cacheLock->Acquire();
+            if (--buffers[i].users == 0) {
+                bufferReleased->Broadcast();
+            }
+            continue;
+        }
+        stats->diskCacheMisses++;
+        if (buffers[i].sector != -1) {
+            HashRemove(i);
+        }
+        buffers[i].sector = sector;
+        buffers[i].valid = false;
+        HashInsert(i);
+        break;
+    }
+    buffers[i].users++;
+    LruRemove(i);
+    LruPushFront(i);
+    cacheLock->Release();
+    return &buffers[i];
+}
+
+SynchDisk::Buffer *
+SynchDisk::GetCleanBuffer(int sector)
+{
+    ASSERT(sector >= 0 && (unsigned) sector < NUM_SECTORS);
+
+    cacheLock->Acquire();
+    if (Lookup(sector) != -1) {
+        cacheLock->Release();
+        return nullptr;  // Read by someone else since it was queued.
+    }
+    int i = PickVictim();
+    if (i == -1 || buffers[i].dirty) {
+        // Have the flush daemon make clean buffers for the next ones.
+        bool wake = i != -1 && !flushRequested;
+        if (wake) {
+            flushRequested = true;
+        }
+        cacheLock->Release();
+        if (wake) {
+            flushNeeded->V();
+        }
+        return nullptr;
+    }
+    if (buffers[i].sector != -1) {
+        HashRemove(i);
+    }
+    buffers[i].sector = sector;
+    buffers[i].valid = false;
+    HashInsert(i);
+    buffers[i].users++;
+    LruRemove(i);
+    LruPushFront(i);
+    cacheLock->Release();
+    return &buffers[i];
+}
+
+int
+SynchDisk::PickVictim() const
+{
+    int dirtyVictim = -1;
+    for (int i = lruTail; i != -1; i = buffers[i].lruPrev) {
+        if (buffers[i].users > 0) {
+            continue;
+        }
+        if (!buffers[i].dirty) {
+            return i;
+        }
+        if (dirtyVictim == -1) {
+            dirtyVictim = i;
+        }
+    }
+    return dirtyVictim;
+}
+
+void
+SynchDisk::Clean(Buffer *b)
+{
+    ASSERT(b->users > 0);
+
+    b->lock->Acquire();
+    if (b->dirty) {
+        DiskWrite(b->sector, b->data);
+        b->dirty = false;
+        cacheLock->Acquire();
+        numDirty--;
+        cacheLock->Release();
+    }
+    b->lock->Release();
+}
+
+void
+SynchDisk::PutBuffer(Buffer *b)
+{
+    cacheLock->Acquire();
+    ASSERT(b->users > 0);
+    if (--b->users == 0) {
+        bufferReleased->Broadcast();
+    }
+    cacheLock->Release();
+}
+
 /// Read the contents of a disk sector into a buffer.  Return only after the
 /// data has been read.
 ///
@@ -56,10 +315,15 @@ SynchDisk::ReadSector(int sectorNumber, char *data)
 {
     ASSERT(data != nullptr);
 
-    lock->Acquire();  // Only one disk I/O at a time.
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();   // Wait for interrupt.
-    lock->Release();
+    Buffer *b = GetBuffer(sectorNumber);
+    b->lock->Acquire();
+    if (!b->valid) {
+        DiskRead(sectorNumber, b->data);
+        b->valid = true;
+    }
+    memcpy(data, b->data, SECTOR_SIZE);
+    b->lock->Release();
+    PutBuffer(b);
 }
 
 /// Write the contents of a buffer into a disk sector.  Return only
@@ -72,9 +336,145 @@ SynchDisk::WriteSector(int sectorNumber, const char *data)
 {
     ASSERT(data != nullptr);
 
-    lock->Acquire();  // only one disk I/O at a time
+    Buffer *b = GetBuffer(sectorNumber);
+    b->lock->Acquire();
+    memcpy(b->data, data, SECTOR_SIZE);
+    b->valid = true;
+    cacheLock->Acquire();
+    if (b->dirty) {
+        stats->diskWritesAbsorbed++;  // The previous write never hit disk.
+    } else {
+        b->dirty = true;
+        numDirty++;
+    }
+    b->dirtySeq = ++writeSeq;
+    // Wake the daemon once, not on every write until it gets to run.
+    bool pressure = numDirty >= DIRTY_HIGH_WATER && !flushRequested;
+    if (pressure) {
+        flushRequested = true;
+    }
+    cacheLock->Release();
+    b->lock->Release();
+    PutBuffer(b);
+
+    if (pressure) {
+        flushNeeded->V();
+    }
+}
+
+/// Write back every dirty buffer, oldest modification first.
+void
+SynchDisk::Flush()
+{
+    int order[CACHE_SIZE];
+    unsigned count = 0;
+
+    cacheLock->Acquire();
+    flushRequested = false;
+    for (unsigned i = 0; i < CACHE_SIZE; i++) {
+        if (!buffers[i].dirty) {
+            continue;
+        }
+        // Insertion sort by modification order; the cache is small.
+        unsigned j = count++;
+        for (; j > 0 && buffers[order[j - 1]].dirtySeq > buffers[i].dirtySeq;
+             j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+        buffers[i].users++;  // Keep it from being reused.
+    }
+    cacheLock->Release();
+
+    DEBUG('f', "Flushing %u dirty sectors\n", count);
+    for (unsigned k = 0; k < count; k++) {
+        Clean(&buffers[order[k]]);
+        PutBuffer(&buffers[order[k]]);
+    }
+}
+
+void
+SynchDisk::FlushTick()
+{
+    flushNeeded->V();
+}
+
+void
+SynchDisk::FlushDaemon()
+{
+    for (;;) {
+        flushNeeded->P();
+        Flush();
+    }
+}
+
+bool
+SynchDisk::Prefetch(int sectorNumber)
+{
+    ASSERT(sectorNumber >= 0 && sectorNumber < (int) NUM_SECTORS);
+
+    cacheLock->Acquire();
+    if (Lookup(sectorNumber) != -1) {
+        cacheLock->Release();
+        return true;
+    }
+    bool queued = prefetchCount < PREFETCH_QUEUE_SIZE;
+    if (queued) {
+        unsigned tail = (prefetchHead + prefetchCount) % PREFETCH_QUEUE_SIZE;
+        prefetchQueue[tail] = sectorNumber;
+        prefetchCount++;
+    }
+    cacheLock->Release();
+
+    if (queued) {
+        prefetchNeeded->V();
+    }
+    return queued;
+}
+
+void
+SynchDisk::Prefetcher()
+{
+    for (;;) {
+        prefetchNeeded->P();
+        cacheLock->Acquire();
+        int sector = prefetchQueue[prefetchHead];
+        prefetchHead = (prefetchHead + 1) % PREFETCH_QUEUE_SIZE;
+        prefetchCount--;
+        cacheLock->Release();
+
+        // Writing a dirty buffer back first would keep the disk busy for
+        // as long as the read saves, so leave that to the flush daemon.
+        Buffer *b = GetCleanBuffer(sector);
+        if (b == nullptr) {
+            continue;
+        }
+        b->lock->Acquire();
+        if (!b->valid) {
+            stats->diskPrefetches++;
+            DiskRead(sector, b->data);
+            b->valid = true;
+        }
+        b->lock->Release();
+        PutBuffer(b);
+    }
+}
+
+void
+SynchDisk::DiskRead(int sectorNumber, char *data)
+{
+    lock->Acquire();  // Only one disk I/O at a time.
+    disk->ReadRequest(sectorNumber, data);
+    semaphore->P();   // Wait for interrupt.
+    lock->Release();
+}
+
+void
+SynchDisk::DiskWrite(int sectorNumber, const char *data)
+{
+    lock->Acquire();  // Only one disk I/O at a time.
     disk->WriteRequest(sectorNumber, data);
-    semaphore->P();   // wait for interrupt
+    semaphore->P();   // Wait for interrupt.
     lock->Release();
 }
 
@@ -10,10 +10,27 @@
 
 
 #include "machine/disk.hh"
+#include "threads/condition.hh"
 #include "threads/lock.hh"
 #include "threads/semaphore.hh"
 
 
+/// Number of sectors kept in the buffer cache.
+const unsigned CACHE_SIZE = 64;
+
+/// Number of hash chains used to look sectors up in the cache.
+const unsigned CACHE_BUCKETS = 32;
+
+/// Ticks between two runs of the flush daemon.
+const unsigned FLUSH_INTERVAL = 50000;
+
+/// Number of dirty buffers that makes the flush daemon run right away.
+const unsigned DIRTY_HIGH_WATER = CACHE_SIZE / 2;
+
+/// Number of sectors that can wait to be prefetched.  Later requests are
+/// dropped.
+const unsigned PREFETCH_QUEUE_SIZE = 16;
+
 /// The following class defines a "synchronous" disk abstraction.
 ///
 /// As with other I/O devices, the raw physical disk is an asynchronous
@@ -24,6 +41,22 @@
 ///
 /// This class provides the abstraction that for any individual thread making
 /// a request, it waits around until the operation finishes before returning.
+///
+/// Recently used sectors are kept in a buffer cache with LRU replacement,
+/// so reading them again does not touch the disk.  Every buffer has its own
+/// lock, held only while its contents are being filled or copied, so
+/// threads working on different sectors do not wait for each other unless
+/// they need the disk.
+///
+/// Writes only update the cache.  Dirty buffers reach the disk when they
+/// are evicted, when a flush daemon thread wakes up (every
+/// `FLUSH_INTERVAL` ticks, or once `DIRTY_HIGH_WATER` buffers are dirty),
+/// or on `Flush`.  Flushes write sectors in the order they were last
+/// modified, so the file system controls the order in which metadata
+/// reaches the disk by the order in which it writes it.
+///
+/// Sectors can also be read ahead with `Prefetch`: a prefetcher thread
+/// brings them into the cache while the thread that asked goes on.
 class SynchDisk {
 public:
 
@@ -34,17 +67,95 @@ public:
     ~SynchDisk();
 
     /// Read/write a disk sector, returning only once the data is actually
-    /// read or written.  These call `Disk::ReadRequest`/`WriteRequest` and
-    /// then wait until the request is done.
+    /// read or written.  On a cache miss, these call
+    /// `Disk::ReadRequest`/`WriteRequest` and then wait until the request
+    /// is done.
 
     void ReadSector(int sectorNumber, char *data);
     void WriteSector(int sectorNumber, const char *data);
 
+    /// Write every dirty sector to the disk, returning once they are all
+    /// written.
+    void Flush();
+
+    /// Wake the flush daemon.  Called by the flush timer.
+    void FlushTick();
+
+    /// Body of the flush daemon thread.
+    void FlushDaemon();
+
+    /// Ask for `sectorNumber` to be brought into the cache in the
+    /// background.  Return false if the request had to be dropped because
+    /// the queue is full; a sector already cached counts as done.
+    bool Prefetch(int sectorNumber);
+
+    /// Body of the prefetcher thread.
+    void Prefetcher();
+
     /// Called by the disk device interrupt handler, to signal that the
     /// current disk operation is complete.
     void RequestDone();
 
 private:
+    struct Buffer {
+        int sector;       ///< Sector held, or -1 if the buffer is free.
+        bool valid;       ///< Whether `data` has been filled.
+        bool dirty;       ///< Whether `data` is newer than the disk.
+        unsigned long dirtySeq;  ///< When `data` was last modified.
+        unsigned users;   ///< Threads using the buffer; it is not evicted
+                          ///< while there are any.
+        Lock *lock;       ///< Held while `data` is read or written.
+        int hashNext;     ///< Next buffer in the same hash chain.
+        int lruPrev;      ///< Neighbours in the LRU list, -1 at the ends.
+        int lruNext;
+        char data[SECTOR_SIZE];
+    };
+
+    /// Return the buffer holding `sector`, allocating one (and counting a
+    /// miss) if it is not cached.  The buffer is marked as used; call
+    /// `PutBuffer` when done.
+    Buffer *GetBuffer(int sector);
+    void PutBuffer(Buffer *b);
+
+    /// Like `GetBuffer` for a sector that is not cached, but only reuse a
+    /// clean buffer: return null rather than wait for a write back.
+    Buffer *GetCleanBuffer(int sector);
+
+    /// Return the least recently used buffer nobody is using, preferring
+    /// clean ones, or -1 if every buffer is in use.
+    int PickVictim() const;
+
+    /// Write `b` to the disk if it is dirty.  The caller must be using
+    /// `b` and must not hold `cacheLock`.
+    void Clean(Buffer *b);
+
+    int Lookup(int sector) const;
+    void HashInsert(int index);
+    void HashRemove(int index);
+    void LruRemove(int index);
+    void LruPushFront(int index);
+
+    /// Access the disk itself.
+    void DiskRead(int sectorNumber, char *data);
+    void DiskWrite(int sectorNumber, const char *data);
+
+    Buffer buffers[CACHE_SIZE];
+    int buckets[CACHE_BUCKETS];
+    int lruHead;  ///< Most recently used buffer.
+    int lruTail;  ///< Least recently used buffer.
+    Lock *cacheLock;            ///< Protects everything but buffer data.
+    Condition *bufferReleased;  ///< Signalled when a buffer stops being
+                                ///< used, for threads finding none free.
+    unsigned numDirty;
+    unsigned long writeSeq;     ///< Source of `dirtySeq` values.
+    Semaphore *flushNeeded;     ///< Wakes the flush daemon.
+    bool flushRequested;        ///< Whether writes already woke it for
+                                ///< the dirty buffers there are.
+    int prefetchQueue[PREFETCH_QUEUE_SIZE];  ///< Sectors to prefetch.
+    unsigned prefetchHead;
+    unsigned prefetchCount;
+    Semaphore *prefetchNeeded;  ///< Counts sectors in `prefetchQueue`.
+
     Disk *disk;  ///< Raw disk device.
     Semaphore *semaphore;  ///< To synchronize requesting thread with the
                            ///< interrupt handler.
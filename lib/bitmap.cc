@@ -8,8 +8,10 @@
 
 
 #include "bitmap.hh"
+#include "machine/disk.hh"
 
 #include <stdio.h>
+#include <string.h>
 
 
 /// Initialize a bitmap with `nitems` bits, so that every bit is clear.  It
@@ -23,9 +25,11 @@ Bitmap::Bitmap(unsigned nitems)
     numBits  = nitems;
     numWords = DivRoundUp(numBits, BITS_IN_WORD);
     map      = new unsigned [numWords];
-    for (unsigned i = 0; i < numBits; i++) {
-        Clear(i);
-    }
+    memset(map, 0, numWords * sizeof (unsigned));
+    numClear = numBits;
+    hint     = 0;
+    dirtyLow = 0;
+    dirtyHigh = numWords;
 }
 
 /// De-allocate a bitmap.
@@ -41,7 +45,14 @@ void
 Bitmap::Mark(unsigned which)
 {
     ASSERT(which < numBits);
-    map[which / BITS_IN_WORD] |= 1 << which % BITS_IN_WORD;
+
+    unsigned w = which / BITS_IN_WORD;
+    unsigned bit = 1U << which % BITS_IN_WORD;
+    if (!(map[w] & bit)) {
+        map[w] |= bit;
+        numClear--;
+        Touch(w);
+    }
 }
 
 /// Clear the “nth” bit in a bitmap.
@@ -51,7 +62,27 @@ void
 Bitmap::Clear(unsigned which)
 {
     ASSERT(which < numBits);
-    map[which / BITS_IN_WORD] &= ~(1 << which % BITS_IN_WORD);
+
+    unsigned w = which / BITS_IN_WORD;
+    unsigned bit = 1U << which % BITS_IN_WORD;
+    if (map[w] & bit) {
+        map[w] &= ~bit;
+        numClear++;
+        Touch(w);
+    }
+}
+
+void
+Bitmap::Touch(unsigned w)
+{
+    if (dirtyLow >= dirtyHigh) {
+        dirtyLow = w;
+        dirtyHigh = w + 1;
+    } else if (w < dirtyLow) {
+        dirtyLow = w;
+    } else if (w >= dirtyHigh) {
+        dirtyHigh = w + 1;
+    }
 }
 
 /// Return true if the “nth” bit is set.
@@ -61,20 +92,83 @@ bool
 Bitmap::Test(unsigned which) const
 {
     ASSERT(which < numBits);
-    return map[which / BITS_IN_WORD] & 1 << which % BITS_IN_WORD;
+    return map[which / BITS_IN_WORD] & 1U << which % BITS_IN_WORD;
+}
+
+unsigned
+Bitmap::ClearBitsOf(unsigned w) const
+{
+    unsigned bits = ~map[w];
+    unsigned tail = numBits - w * BITS_IN_WORD;
+    if (tail < BITS_IN_WORD) {
+        bits &= (1U << tail) - 1;
+    }
+    return bits;
 }
 
-/// Return the number of the first bit which is clear.  As a side effect, set
-/// the bit (mark it as in use).  (In other words, find and allocate a bit.)
+unsigned
+Bitmap::Next(unsigned from, bool set) const
+{
+    if (from >= numBits) {
+        return numBits;
+    }
+    unsigned w = from / BITS_IN_WORD;
+    unsigned bits = set ? map[w] : ClearBitsOf(w);
+    bits &= ~0U << from % BITS_IN_WORD;  // Skip the bits before `from`.
+    while (bits == 0) {
+        if (++w >= numWords) {
+            return numBits;
+        }
+        bits = set ? map[w] : ClearBitsOf(w);
+    }
+    unsigned found = w * BITS_IN_WORD + __builtin_ctz(bits);
+    return found < numBits ? found : numBits;
+}
+
+/// Return the number of the first bit which is clear, at or after the one
+/// following the last bit found.  As a side effect, set the bit (mark it as
+/// in use).  (In other words, find and allocate a bit.)
 ///
 /// If no bits are clear, return -1.
 int
 Bitmap::Find()
 {
-    for (unsigned i = 0; i < numBits; i++) {
-        if (!Test(i)) {
-            Mark(i);
-            return i;
+    if (numClear == 0) {
+        return -1;
+    }
+    unsigned i = Next(hint, false);
+    if (i == numBits) {
+        i = Next(0, false);  // Wrap around.
+    }
+    ASSERT(i < numBits);
+    Mark(i);
+    hint = i + 1 < numBits ? i + 1 : 0;
+    return i;
+}
+
+/// Find and allocate a run of bits.
+///
+/// * `count` is the number of consecutive bits wanted.
+int
+Bitmap::FindRun(unsigned count)
+{
+    ASSERT(count > 0);
+
+    if (count > numClear) {
+        return -1;
+    }
+    // Two passes: from the hint to the end, then from the start.  A run
+    // crossing the hint is found in the second one.
+    for (unsigned pass = 0; pass < 2; pass++) {
+        unsigned from = pass == 0 ? hint : 0;
+        unsigned start, length;
+        while (NextClearRun(from, &start, &length)) {
+            if (length >= count) {
+                MarkRun(start, count);
+                hint = start + count < numBits ? start + count : 0;
+                return start;
+            }
+            from = start + length;
         }
     }
     return -1;
@@ -85,14 +179,51 @@ Bitmap::Find()
 unsigned
 Bitmap::CountClear() const
 {
-    unsigned count = 0;
+    return numClear;
+}
 
-    for (unsigned i = 0; i < numBits; i++) {
-        if (!Test(i)) {
-            count++;
-        }
+/// Find a maximal run of clear bits.
+///
+/// * `from` is the first bit to consider.
+/// * `start` and `length` receive the run found.
+bool
+Bitmap::NextClearRun(unsigned from, unsigned *start,
+                     unsigned *length) const
+{
+    ASSERT(start != nullptr);
+    ASSERT(length != nullptr);
+
+    unsigned first = Next(from, false);
+    if (first >= numBits) {
+        return false;
+    }
+    *start = first;
+    *length = Next(first, true) - first;
+    return true;
+}
+
+/// Set a run of bits.
+///
+/// * `start` is the first bit to set.
+/// * `length` is the number of bits to set.
+void
+Bitmap::MarkRun(unsigned start, unsigned length)
+{
+    ASSERT(start + length <= numBits);
+
+    unsigned i = start;
+    unsigned end = start + length;
+    while (i < end) {
+        unsigned w = i / BITS_IN_WORD;
+        unsigned offset = i % BITS_IN_WORD;
+        unsigned n = BITS_IN_WORD - offset < end - i
+                     ? BITS_IN_WORD - offset : end - i;
+        unsigned mask = n == BITS_IN_WORD ? ~0U : ((1U << n) - 1) << offset;
+        numClear -= __builtin_popcount(~map[w] & mask);
+        map[w] |= mask;
+        Touch(w);
+        i += n;
     }
-    return count;
 }
 
 /// Print the contents of the bitmap, for debugging.
@@ -121,6 +252,12 @@ Bitmap::FetchFrom(OpenFile *file)
 {
     ASSERT(file != nullptr);
     file->ReadAt((char *) map, numWords * sizeof (unsigned), 0);
+    dirtyLow = dirtyHigh = 0;
+    hint = 0;
+    numClear = 0;
+    for (unsigned w = 0; w < numWords; w++) {
+        numClear += __builtin_popcount(ClearBitsOf(w));
+    }
 }
 
 /// Store the contents of a bitmap to a Nachos file.
@@ -129,8 +266,21 @@ Bitmap::FetchFrom(OpenFile *file)
 ///
 /// * `file` is the place to write the bitmap to.
 void
-Bitmap::WriteBack(OpenFile *file) const
+Bitmap::WriteBack(OpenFile *file)
 {
     ASSERT(file != nullptr);
-    file->WriteAt((char *) map, numWords * sizeof (unsigned), 0);
+
+    if (dirtyLow >= dirtyHigh) {
+        return;
+    }
+    // Whole sectors, so that nothing has to be read back first.
+    unsigned size = numWords * sizeof (unsigned);
+    unsigned first = dirtyLow * sizeof (unsigned) / SECTOR_SIZE * SECTOR_SIZE;
+    unsigned last = DivRoundUp(dirtyHigh * (unsigned) sizeof (unsigned),
+                               SECTOR_SIZE) * SECTOR_SIZE;
+    if (last > size) {
+        last = size;
+    }
+    file->WriteAt((char *) map + first, last - first, first);
+    dirtyLow = dirtyHigh = 0;
 }
@@ -3,7 +3,9 @@
 /// vector.
 ///
 /// The bitmap is represented as an array of unsigned integers, on which we
-/// do modulo arithmetic to find the bit we are interested in.
+/// do modulo arithmetic to find the bit we are interested in.  Searches go
+/// a word at a time, and the number of clear bits is kept up to date, so
+/// that allocating from a large bitmap does not visit every bit.
 ///
 /// The data structure is parameterized with with the number of bits being
 /// managed.
@@ -51,13 +53,26 @@ public:
     bool Test(unsigned which) const;
 
     /// Return the index of a clear bit, and as a side effect, set the bit.
+    /// The search starts after the last bit found (next fit).
     ///
     /// If no bits are clear, return -1.
     int Find();
 
+    /// Find `count` consecutive clear bits, starting the search after the
+    /// last bit found, and set them.  Return the first one, or -1 if there
+    /// is no such run.
+    int FindRun(unsigned count);
+
     /// Return the number of clear bits.
     unsigned CountClear() const;
 
+    /// Find the first run of clear bits starting at or after `from`, and
+    /// as long as possible.  Return false if there is none.
+    bool NextClearRun(unsigned from, unsigned *start, unsigned *length) const;
+
+    /// Set `length` bits starting from `start`.
+    void MarkRun(unsigned start, unsigned length);
+
     /// Print contents of bitmap.
     void Print() const;
 
@@ -67,11 +82,13 @@ public:
     /// need to read and write the bitmap to a file.
     void FetchFrom(OpenFile *file);
 
-    /// Write contents to disk.
+    /// Write contents to disk.  Only the sectors holding bits changed since
+    /// the last `FetchFrom` or `WriteBack` are written; a new bitmap counts
+    /// as changed everywhere.
     ///
     /// Note: this is not needed until the *FILESYS* assignment, when we will
     /// need to read and write the bitmap to a file.
-    void WriteBack(OpenFile *file) const;
+    void WriteBack(OpenFile *file);
 
 private:
 
@@ -85,6 +102,28 @@ private:
     /// Bit storage.
     unsigned *map;
 
+    /// Range of words changed since the bitmap was last read or written;
+    /// empty if `dirtyLow >= dirtyHigh`.
+    unsigned dirtyLow;
+    unsigned dirtyHigh;
+
+    /// Number of clear bits.
+    unsigned numClear;
+
+    /// Where the next search starts.
+    unsigned hint;
+
+    /// Note that word `w` changed.
+    void Touch(unsigned w);
+
+    /// Return the clear bits of word `w` as set bits, ignoring those past
+    /// `numBits`.
+    unsigned ClearBitsOf(unsigned w) const;
+
+    /// Return the first bit at or after `from` that is set (if `set`) or
+    /// clear (if not), or `numBits` if there is none.
+    unsigned Next(unsigned from, bool set) const;
+
 };
 
 
@@ -8,145 +8,332 @@
 #define NACHOS_LIB_TABLE__HH
 
 
-#include "list.hh"
+#include "utility.hh"
 
 
+/// A growable table of handles.
+///
+/// An id is made of the index of a slot in its low `INDEX_BITS` bits and of
+/// the generation of that slot above them.  The generation is bumped every
+/// time the slot is freed, so an id kept after its item was removed does
+/// not find whatever item takes the slot next.  Ids of slots that were
+/// never reused are just their index.
+///
+/// Free slots are chained in a doubly linked list threaded through the
+/// slot array, so adding, looking up and removing items are all O(1).  The
+/// array doubles when it runs out of free slots.
 template <class T>
 class Table {
 public:
-    static const unsigned SIZE = 20;
+    static const unsigned INDEX_BITS = 16;
+    static const unsigned GENERATION_BITS = 15;  ///< Ids stay non-negative.
+    static const unsigned MAX_SIZE = 1 << INDEX_BITS;
+    static const unsigned INITIAL_SIZE = 8;
+
+    /// Construct an empty table that will hold at most `maxSize` items.
+    Table(unsigned maxSize = MAX_SIZE);
 
-    /// Construct an empty table.
-    Table();
+    ~Table();
 
-    /// Add an item into a free index.
+    /// Add an item into a free slot.
     ///
     /// Returns -1 if no space is left to add the item.
     int Add(T item);
 
-    /// Get the item associated with a given index.
-    T Get(int i) const;
+    /// Get the item associated with a given id.
+    ///
+    /// Returns `T()` if the id is not assigned.
+    T Get(int id) const;
 
-    /// Check whether a given index has an associated item.
-    bool HasKey(int i) const;
+    /// Check whether a given id has an associated item.
+    bool HasKey(int id) const;
 
     /// Check whether the table is empty.
     bool IsEmpty() const;
 
-    /// Remove the item associated with a given index.
+    /// Remove the item associated with a given id.
+    ///
+    /// Returns the removed item, or `T()` if the id is already unoccupied.
+    T Remove(int id);
+
+    /// Add an item into the slot of a given id, which must be free.
     ///
-    /// Returns the removed item, or `T()` if the index is already
-    /// unoccupied.
-    T Remove(int i);
+    /// Only the index part of `id` is used: the item gets the current
+    /// generation of the slot, so a stale id cannot bring back one that was
+    /// already retired.  Returns the resulting id, or -1 if the slot is
+    /// taken or out of range.
+    int Insert(int id, T item);
 
-    /// Updates the item associated with a given valid index.
+    /// Updates the item associated with a given valid id.
     ///
-    /// The index must be valid, i.e. it must be assigned to some value.
+    /// The id must be valid, i.e. it must be assigned to some value.
     ///
     /// Returns the old item.
-    T Update(int i, T item);
+    T Update(int id, T item);
 
-private:
-    /// Data items.
-    T data[SIZE];
+    /// Number of slots, to walk the table with `IdAt`.
+    unsigned Capacity() const;
+
+    /// Return the id of the item in slot `index`, or -1 if it is free.
+    int IdAt(unsigned index) const;
 
-    /// Current greatest index for a new item.
-    int current;
+    /// Make this empty table hold the same items as `other` under the same
+    /// ids.
+    void CopyFrom(const Table<T> &other);
 
-    /// A list to store indexes of items that have been freed and are not
-    /// among those with greatest numbers, so it is not possible to modify
-    /// `current`.  In other words, this keeps track of external
-    /// fragmentation.
-    List<int> freed;
+private:
+    static const unsigned INDEX_MASK = MAX_SIZE - 1;
+    static const unsigned GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+
+    struct Slot {
+        T item;
+        unsigned generation;
+        bool used;
+        int prevFree;  ///< Neighbours in the free list, -1 at the ends.
+        int nextFree;
+    };
+
+    /// Make room for at least `size` slots.  Returns false if that would
+    /// exceed `maxSize`.
+    bool Grow(unsigned size);
+
+    /// Take the free slot `index` out of the free list.
+    void Unlink(unsigned index);
+
+    /// Put the free slot `index` at the head of the free list.
+    void Push(unsigned index);
+
+    /// Return the slot of `id` if it holds an item under that id.
+    const Slot *Find(int id) const;
+
+    Slot *slots;
+    unsigned capacity;
+    unsigned maxSize;
+    unsigned count;
+    int freeHead;  ///< First free slot, -1 if there is none.
 };
 
 
 template <class T>
-Table<T>::Table()
+Table<T>::Table(unsigned aMaxSize)
 {
-    current = 0;
+    ASSERT(aMaxSize > 0 && aMaxSize <= MAX_SIZE);
+    slots = nullptr;
+    capacity = 0;
+    maxSize = aMaxSize;
+    count = 0;
+    freeHead = -1;
 }
 
+template <class T>
+Table<T>::~Table()
+{
+    delete [] slots;
+}
 
 template <class T>
-int
-Table<T>::Add(T item)
+bool
+Table<T>::Grow(unsigned size)
 {
-    int i;
+    if (size <= capacity) {
+        return true;
+    }
+    if (size > maxSize) {
+        return false;
+    }
+
+    unsigned newCapacity = capacity == 0 ? INITIAL_SIZE : capacity;
+    while (newCapacity < size) {
+        newCapacity *= 2;
+    }
+    if (newCapacity > maxSize) {
+        newCapacity = maxSize;
+    }
+
+    Slot *newSlots = new Slot [newCapacity];
+    for (unsigned i = 0; i < capacity; i++) {
+        newSlots[i] = slots[i];
+    }
+    delete [] slots;
+    slots = newSlots;
+
+    // Chain the new slots so that the lowest index is handed out first.
+    for (unsigned i = newCapacity; i-- > capacity;) {
+        slots[i].item = T();
+        slots[i].generation = 0;
+        slots[i].used = false;
+        Push(i);
+    }
+    capacity = newCapacity;
+    return true;
+}
 
-    if (!freed.IsEmpty()) {
-        i = freed.Pop();
-        data[i] = item;
-        return i;
-    } else if (current < static_cast<int>(SIZE)) {
-        i = current++;
-        data[i] = item;
-        return i;
+template <class T>
+void
+Table<T>::Unlink(unsigned index)
+{
+    Slot &s = slots[index];
+    if (s.prevFree != -1) {
+        slots[s.prevFree].nextFree = s.nextFree;
     } else {
+        freeHead = s.nextFree;
+    }
+    if (s.nextFree != -1) {
+        slots[s.nextFree].prevFree = s.prevFree;
+    }
+}
+
+template <class T>
+void
+Table<T>::Push(unsigned index)
+{
+    slots[index].prevFree = -1;
+    slots[index].nextFree = freeHead;
+    if (freeHead != -1) {
+        slots[freeHead].prevFree = index;
+    }
+    freeHead = index;
+}
+
+template <class T>
+const typename Table<T>::Slot *
+Table<T>::Find(int id) const
+{
+    if (id < 0) {
+        return nullptr;
+    }
+    unsigned index = id & INDEX_MASK;
+    unsigned generation = (unsigned) id >> INDEX_BITS;
+    if (index >= capacity) {
+        return nullptr;
+    }
+    const Slot *s = &slots[index];
+    return s->used && s->generation == generation ? s : nullptr;
+}
+
+template <class T>
+int
+Table<T>::Add(T item)
+{
+    if (freeHead == -1 && !Grow(capacity + 1)) {
         return -1;
     }
+
+    unsigned index = freeHead;
+    Unlink(index);
+    slots[index].item = item;
+    slots[index].used = true;
+    count++;
+    return index | slots[index].generation << INDEX_BITS;
 }
 
 template <class T>
 T
-Table<T>::Get(int i) const
+Table<T>::Get(int id) const
 {
-    ASSERT(i >= 0);
-
-    return HasKey(i) ? data[i] : T();
+    const Slot *s = Find(id);
+    return s != nullptr ? s->item : T();
 }
 
 template <class T>
 bool
-Table<T>::HasKey(int i) const
+Table<T>::HasKey(int id) const
 {
-    ASSERT(i >= 0);
-
-    return i < current && !freed.Has(i);
+    return Find(id) != nullptr;
 }
 
 template <class T>
 bool
 Table<T>::IsEmpty() const
 {
-    return current == 0;
+    return count == 0;
 }
 
 template <class T>
 T
-Table<T>::Remove(int i)
+Table<T>::Remove(int id)
 {
-    ASSERT(i >= 0);
-
-    if (!HasKey(i)) {
+    if (!HasKey(id)) {
         return T();
     }
 
-    if (i == current - 1) {
-        current--;
-        for (int j = current - 1; j >= 0 && !HasKey(j); j--) {
-            ASSERT(freed.Has(j));
-            freed.Remove(j);
-            current--;
-        }
-    } else {
-        freed.SortedInsert(i, i);
+    unsigned index = id & INDEX_MASK;
+    Slot &s = slots[index];
+    T item = s.item;
+    s.item = T();
+    s.used = false;
+    s.generation = (s.generation + 1) & GENERATION_MASK;
+    Push(index);
+    count--;
+    return item;
+}
+
+template <class T>
+int
+Table<T>::Insert(int id, T item)
+{
+    if (id < 0) {
+        return -1;
     }
-    return data[i];
+    unsigned index = id & INDEX_MASK;
+    if (!Grow(index + 1) || slots[index].used) {
+        return -1;
+    }
+
+    Unlink(index);
+    slots[index].item = item;
+    slots[index].used = true;
+    count++;
+    return index | slots[index].generation << INDEX_BITS;
 }
 
 template <class T>
 T
-Table<T>::Update(int i, T item)
+Table<T>::Update(int id, T item)
 {
-    ASSERT(i >= 0);
-    ASSERT(i < current);
-    ASSERT(!freed.Has(i));
+    ASSERT(HasKey(id));
 
-    T previous = data[i];
-    data[i] = item;
+    Slot &s = slots[id & INDEX_MASK];
+    T previous = s.item;
+    s.item = item;
     return previous;
 }
 
+template <class T>
+unsigned
+Table<T>::Capacity() const
+{
+    return capacity;
+}
+
+template <class T>
+int
+Table<T>::IdAt(unsigned index) const
+{
+    if (index >= capacity || !slots[index].used) {
+        return -1;
+    }
+    return index | slots[index].generation << INDEX_BITS;
+}
+
+template <class T>
+void
+Table<T>::CopyFrom(const Table<T> &other)
+{
+    ASSERT(count == 0);
+    ASSERT(other.capacity <= maxSize);
+
+    // Free slots keep their generation too, and the free list is copied
+    // as is, so both tables hand out the same ids from now on.
+    delete [] slots;
+    slots = other.capacity == 0 ? nullptr : new Slot [other.capacity];
+    for (unsigned i = 0; i < other.capacity; i++) {
+        slots[i] = other.slots[i];
+    }
+    capacity = other.capacity;
+    count = other.count;
+    freeHead = other.freeHead;
+}
+
 
 #endif
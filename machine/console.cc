@@ -72,7 +72,8 @@ Console::Console(const char *readFile, const char *writeFile,
     readHandler  = readAvail;
     handlerArg   = callArg;
     putBusy      = false;
-    incoming     = EOF;
+    putCount     = 0;
+    incomingHead = incomingCount = 0;
 
     // Start polling for incoming packets.
     interrupt->Schedule(ConsoleReadPoll, this,
@@ -90,12 +91,11 @@ Console::~Console()
     }
 }
 
-/// Periodically called to check if a character is available for
-/// input from the simulated keyboard (eg, has it been typed?).
+/// Periodically called to check if characters are available for
+/// input from the simulated keyboard (eg, have they been typed?).
 ///
-/// Only read it in if there is buffer space for it (if the previous
-/// character has been grabbed out of the buffer by the Nachos kernel).
-/// Invoke the “read” interrupt handler, once the character has been put into
+/// Read in as many as there are, while there is buffer space for them.
+/// Invoke the “read” interrupt handler once for every character put into
 /// the buffer.
     void
 Console::CheckCharAvail()
@@ -106,25 +106,25 @@ Console::CheckCharAvail()
     interrupt->Schedule(ConsoleReadPoll, this,
             CONSOLE_TIME, CONSOLE_READ_INT);
 
-    // Do nothing if character is already buffered, or none to be read.
-    if (incoming != EOF || !SystemDep::PollFile(readFileNo)) {
-        return;
+    // Read characters while the buffer has room and there are some to be
+    // read, and tell the user about each of them.
+    while (incomingCount < CONSOLE_INPUT_SIZE
+             && SystemDep::PollFile(readFileNo)) {
+        SystemDep::Read(readFileNo, &c, sizeof c);
+        incoming[(incomingHead + incomingCount) % CONSOLE_INPUT_SIZE] = c;
+        incomingCount++;
+        stats->numConsoleCharsRead++;
+        (*readHandler)(handlerArg);
     }
-
-    // Otherwise, read character and tell user about it.
-    SystemDep::Read(readFileNo, &c, sizeof c);
-    incoming = c;
-    stats->numConsoleCharsRead++;
-    (*readHandler)(handlerArg);
 }
 
 /// Internal routine called when it is time to invoke the interrupt handler
-/// to tell the Nachos kernel that the output character has completed.
+/// to tell the Nachos kernel that the output characters have completed.
 void
 Console::WriteDone()
 {
     putBusy = false;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -133,20 +133,42 @@ Console::WriteDone()
 char
 Console::GetChar()
 {
-    char ch = incoming;
+    if (incomingCount == 0) {
+        return EOF;
+    }
 
-    incoming = EOF;
+    char ch = incoming[incomingHead];
+    incomingHead = (incomingHead + 1) % CONSOLE_INPUT_SIZE;
+    incomingCount--;
     return ch;
 }
 
+bool
+Console::HasInput() const
+{
+    return incomingCount > 0;
+}
+
 /// Write a character to the simulated display, schedule an interrupt to
 /// occur in the future, and return.
 void
 Console::PutChar(char ch)
+{
+    PutBuffer(&ch, 1);
+}
+
+/// Write a burst of characters to the simulated display, schedule a single
+/// interrupt to occur in the future, and return.
+void
+Console::PutBuffer(const char *buffer, unsigned size)
 {
     ASSERT(!putBusy);
-    SystemDep::WriteFile(writeFileNo, &ch, sizeof (char));
+    ASSERT(buffer != nullptr);
+    ASSERT(size > 0 && size <= CONSOLE_BURST_SIZE);
+
+    SystemDep::WriteFile(writeFileNo, buffer, size);
     putBusy = true;
+    putCount = size;
     interrupt->Schedule(ConsoleWriteDone, this,
                         CONSOLE_TIME, CONSOLE_WRITE_INT);
 }
@@ -27,6 +27,14 @@
 #include "lib/utility.hh"
 
 
+/// Maximum number of characters sent to the display in a single burst.
+const unsigned CONSOLE_BURST_SIZE = 64;
+
+/// Number of keyboard characters the device can hold before they are
+/// gotten by the kernel.
+const unsigned CONSOLE_INPUT_SIZE = 128;
+
+
 /// The following class defines a hardware console device.
 ///
 /// Input and output to the device is simulated by reading and writing to
@@ -53,11 +61,23 @@ public:
     /// `writeHandler` is called when the I/O completes.
     void PutChar(char ch);
 
+    /// Write the `size` characters of `buffer` to the display as a single
+    /// burst, and return immediately.  `writeHandler` is called once, when
+    /// the whole burst completes.  At most `CONSOLE_BURST_SIZE` characters
+    /// can be written at a time.
+    void PutBuffer(const char *buffer, unsigned size);
+
     /// Poll the console input.  If a char is available, return it.
     /// Otherwise, return EOF.  `readHandler` is called whenever there is a
     /// char to be gotten.
+    ///
+    /// Characters typed between two polls are all read in at once and
+    /// queued, and `readHandler` is called once for each of them.
     char GetChar();
 
+    /// Check whether `GetChar` would return a character.
+    bool HasInput() const;
+
     // Internal emulation routines -- DO NOT call these.
     // Internal routines to signal I/O completion.
 
@@ -74,8 +94,13 @@ public:
     void *handlerArg;  ///< argument to be passed to the interrupt handlers.
     bool putBusy;  ///< Is a `PutChar` operation in progress?  If so, you
                    ///< cannot do another one!
-    char incoming;  ///< Contains the character to be read, if there is one
-                    ///< available.  Otherwise contains EOF.
+    unsigned putCount;  ///< Number of characters in the burst in progress.
+
+    /// Characters read from the keyboard and not yet gotten, in arrival
+    /// order.
+    char incoming[CONSOLE_INPUT_SIZE];
+    unsigned incomingHead;
+    unsigned incomingCount;
 };
 
 
@@ -32,6 +32,7 @@
 #include "machine.hh"
 #include "endianness.hh"
 #include "system.hh"
+#include "bin/page_trace.h"
 #include <stdio.h>
 extern Machine* machine;
 
@@ -50,7 +51,7 @@ MMU::MMU(unsigned aNumPhysPages)
     tlb = nullptr;
     pageTable = nullptr;
 #endif
-   
+    traceFile = nullptr;
 }
 
 MMU::~MMU()
@@ -58,6 +59,35 @@ MMU::~MMU()
     if (tlb != nullptr) {
         delete [] tlb;
     }
+    if (traceFile != nullptr) {
+        fclose(traceFile);
+    }
+}
+
+bool
+MMU::StartTrace(const char *path)
+{
+    ASSERT(path != nullptr);
+    ASSERT(traceFile == nullptr);
+
+    traceFile = fopen(path, "wb");
+    if (traceFile == nullptr) {
+        return false;
+    }
+    pageTraceHeader header = { PAGE_TRACE_MAGIC, PAGE_SIZE };
+    fwrite(&header, sizeof header, 1, traceFile);
+    return true;
+}
+
+void
+MMU::RecordReference(unsigned vpn, bool writing)
+{
+    pageTraceRecord r;
+    r.tick  = (uint32_t) stats->totalTicks;
+    r.vpn   = vpn;
+    r.pid   = (uint32_t) currentThread->GetId();
+    r.flags = writing ? PAGE_TRACE_WRITE : 0;
+    fwrite(&r, sizeof r, 1, traceFile);
 }
 
 void
@@ -274,6 +304,10 @@ MMU::Translate(unsigned virtAddr, unsigned *physAddr,
         entry->dirty = true;
     }
 
+    if (traceFile != nullptr) {
+        RecordReference(vpn, writing);
+    }
+
     *physAddr = pageFrame * PAGE_SIZE + offset;
     ASSERT(*physAddr >= 0 && *physAddr + size <= memorySize);
     DEBUG_CONT('a', "physical address 0x%X\n", *physAddr);
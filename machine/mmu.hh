@@ -13,6 +13,8 @@
 #include "disk.hh"
 #include "translation_entry.hh"
 
+#include <stdio.h>
+
 
 /// Definitions related to the size, and format of user memory.
 
@@ -47,6 +49,10 @@ public:
 
     void PrintTLB() const;
 
+    /// Record every successful translation into the file at `path`, in
+    /// the format described in `bin/page_trace.h`.
+    bool StartTrace(const char *path);
+
     /// Data structures -- all of these are accessible to Nachos kernel code.
     /// “Public” for convenience.
     ///
@@ -92,6 +98,13 @@ private:
     /// completed.
     ExceptionType Translate(unsigned virtAddr, unsigned *physAddr,
                             unsigned size, bool writing);
+
+    /// Append a reference to the trace file.
+    void RecordReference(unsigned vpn, bool writing);
+
+    /// Trace file, or null when tracing is disabled.
+    FILE *traceFile;
+
     unsigned memorySize;
     unsigned numPhysicalPages;
 };
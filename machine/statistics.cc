@@ -19,8 +19,15 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    diskCacheHits = diskCacheMisses = diskWritesAbsorbed = 0;
+    diskPrefetches = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
+    numSyscalls = 0;
+    execCacheHits = execCacheMisses = 0;
     numPageFaults = 0; tlbHit = 0; tlbMiss = 0; readFromSwap = 0; writeToSwap = 0;
+    zeroPagesSkipped = 0;
+    swapPoolStores = swapPoolHits = swapPoolSpills = 0;
+    swapPoolRawBytes = swapPoolCompressedBytes = 0;
 #ifdef DFS_TICKS_FIX
     tickResets = 0;
 #endif
@@ -41,8 +48,19 @@ Statistics::Print()
     printf("Ticks: total %lu, idle %lu, system %lu, user %lu\n",
            totalTicks, idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %lu, writes %lu\n", numDiskReads, numDiskWrites);
+#ifdef FILESYS
+    printf("Disk cache: hits %lu, misses %lu, writes absorbed %lu, "
+           "prefetches %lu\n",
+           diskCacheHits, diskCacheMisses, diskWritesAbsorbed,
+           diskPrefetches);
+#endif
     printf("Console I/O: reads %lu, writes %lu\n",
            numConsoleCharsRead, numConsoleCharsWritten);
+#ifdef USER_PROGRAM
+    printf("System calls: %lu\n", numSyscalls);
+    printf("Executable cache: hits %lu, misses %lu\n",
+           execCacheHits, execCacheMisses);
+#endif
     printf("Paging: faults %lu\n", numPageFaults);
 #ifdef USE_TLB
     printf("TLB: hit ratio %f\n", static_cast<float>(tlbHit)/(tlbHit+tlbMiss));
@@ -52,5 +70,14 @@ Statistics::Print()
 
 #ifdef SWAP
     printf("Swap: reads %lu, writes %lu\n", readFromSwap, writeToSwap);
+    printf("Swap: zero pages skipped %lu\n", zeroPagesSkipped);
+#endif
+#ifdef SWAP_POOL
+    printf("Swap pool: stores %lu, hits %lu, spills %lu\n",
+           swapPoolStores, swapPoolHits, swapPoolSpills);
+    printf("Swap pool: compression ratio %f\n", swapPoolCompressedBytes == 0
+           ? 0.0 : static_cast<float>(swapPoolRawBytes)/swapPoolCompressedBytes);
+    printf("Swap pool: avoided swap file reads %lu, writes %lu\n",
+           swapPoolHits, swapPoolStores);
 #endif
 }
@@ -38,12 +38,30 @@ public:
     /// Number of disk write requests.
     unsigned long numDiskWrites;
 
+    /// Sector accesses served by the disk buffer cache, and those that had
+    /// to allocate a buffer.
+    unsigned long diskCacheHits;
+    unsigned long diskCacheMisses;
+
+    /// Sector writes overwritten in the cache before reaching the disk.
+    unsigned long diskWritesAbsorbed;
+
+    /// Sectors read into the disk cache ahead of being asked for.
+    unsigned long diskPrefetches;
+
     /// Number of characters read from the keyboard.
     unsigned long numConsoleCharsRead;
 
     /// Number of characters written to the display.
     unsigned long numConsoleCharsWritten;
 
+    /// Number of system calls made by user programs.
+    unsigned long numSyscalls;
+
+    /// Programs started from the executable cache, and loaded from files.
+    unsigned long execCacheHits;
+    unsigned long execCacheMisses;
+
     /// Number of virtual memory page faults.
     unsigned long numPageFaults;
 
@@ -57,6 +75,22 @@ public:
 
     unsigned long writeToSwap;
 
+    /// Evicted pages that were all zeroes and were not written anywhere.
+    unsigned long zeroPagesSkipped;
+
+    /// Pages kept in the compressed swap pool instead of the swap file.
+    unsigned long swapPoolStores;
+
+    /// Pages brought back from the compressed swap pool.
+    unsigned long swapPoolHits;
+
+    /// Pages that did not fit in the pool and went to the swap file.
+    unsigned long swapPoolSpills;
+
+    /// Bytes given to the pool, before and after compression.
+    unsigned long swapPoolRawBytes;
+    unsigned long swapPoolCompressedBytes;
+
 #ifdef DFS_TICKS_FIX
     /// Number of times the tick count gets reset.
     unsigned long tickResets;
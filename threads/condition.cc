@@ -20,6 +20,7 @@
 
 Condition::Condition(const char *debugName, Lock *conditionLock)
 {
+    name = debugName;
     lock = conditionLock;
     waiting = 0; 
     condition = new Semaphore(debugName, 0);
@@ -31,7 +32,6 @@ Condition::~Condition()
 
     delete condition;
     delete waitingLock;
-    delete name;
 
 }
 
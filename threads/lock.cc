@@ -34,7 +34,6 @@ Lock::Lock(const char *debugName)
 
 Lock::~Lock()
 {
-    delete name;
     delete lock;
     delete prioritiesLock;
 }
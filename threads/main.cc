@@ -12,10 +12,12 @@
 ///
 ///     nachos [-d <debugflags>] [-do <debugopts>] 
 ///            [-rs <random seed #>] [-z] [-tt|-tN] 
-///            [-m <num phys pages>]
+///            [-m <num phys pages>] [-sp <swap pool pages>]
+///            [-pt <trace file>]
 ///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>] 
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
-///            [-rm <nachos file>] [-ls] [-D] [-c] [-tf]
+///            [-rm <nachos file>] [-mkdir <nachos dir>] [-rmdir <nachos dir>]
+///            [-ls] [-D] [-c] [-tf]
 ///
 /// General options
 /// ---------------
@@ -27,6 +29,9 @@
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
 /// * `-z`  -- prints version and copyright information, and exits.
 /// * `-m`  -- size of emulated physical memory (in pages)
+/// * `-sp` -- size of the compressed swap pool (in pages)
+/// * `-pt` -- records every page reference into a trace file, to be
+///            replayed with `bin/pagesim`.
 ///
 /// *THREADS* options
 /// -----------------
@@ -49,7 +54,9 @@
 /// * `-cp` -- copies a file from UNIX to Nachos.
 /// * `-pr` -- prints a Nachos file to standard output.
 /// * `-rm` -- removes a Nachos file from the file system.
-/// * `-ls` -- lists the contents of the Nachos directory.
+/// * `-mkdir` -- creates a Nachos directory.
+/// * `-rmdir` -- removes an empty Nachos directory.
+/// * `-ls` -- lists the contents of the Nachos root directory.
 /// * `-D`  -- prints the contents of the entire file system.
 /// * `-c`  -- checks the filesystem integrity.
 /// * `-tf` -- tests the performance of the Nachos file system.
@@ -77,6 +84,9 @@
 #ifdef THREADS
     #include <stdlib.h>
 #endif
+#ifdef FILESYS
+    #include "filesys/synch_disk.hh"
+#endif
 
 
 // External functions used by this file.
@@ -167,6 +177,14 @@ main(int argc, char **argv)
             ASSERT(argc > 1);
             fileSystem->Remove(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-mkdir")) {  // Make Nachos directory.
+            ASSERT(argc > 1);
+            fileSystem->Mkdir(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-rmdir")) {  // Remove Nachos directory.
+            ASSERT(argc > 1);
+            fileSystem->Rmdir(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-ls")) {  // List Nachos directory.
             fileSystem->List();
             printf("\n");
@@ -181,6 +199,9 @@ main(int argc, char **argv)
         }
 #endif
     }
+#ifdef FILESYS
+    synchDisk->Flush();  // Do not leave the commands' writes in the cache.
+#endif
 
     currentThread->Finish();
       // NOTE: if the procedure `main` returns, then the program `nachos`
@@ -0,0 +1,97 @@
+/// Routines for reader/writer locks, built on a lock and two condition
+/// variables.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "rw_lock.hh"
+#include "system.hh"
+
+
+ReadWriteLock::ReadWriteLock(const char *debugName)
+{
+    name = debugName;
+    lock = new Lock(debugName);
+    canRead = new Condition(debugName, lock);
+    canWrite = new Condition(debugName, lock);
+    readers = 0;
+    waitingWriters = 0;
+    writer = nullptr;
+}
+
+ReadWriteLock::~ReadWriteLock()
+{
+    ASSERT(readers == 0 && writer == nullptr);
+    delete canRead;
+    delete canWrite;
+    delete lock;
+}
+
+const char *
+ReadWriteLock::GetName() const
+{
+    return name;
+}
+
+void
+ReadWriteLock::AcquireRead()
+{
+    ASSERT(writer != currentThread);
+
+    lock->Acquire();
+    while (writer != nullptr || waitingWriters > 0) {
+        canRead->Wait();
+    }
+    readers++;
+    lock->Release();
+}
+
+void
+ReadWriteLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0) {
+        canWrite->Signal();
+    }
+    lock->Release();
+}
+
+void
+ReadWriteLock::AcquireWrite()
+{
+    ASSERT(writer != currentThread);
+
+    lock->Acquire();
+    waitingWriters++;
+    while (writer != nullptr || readers > 0) {
+        canWrite->Wait();
+    }
+    waitingWriters--;
+    writer = currentThread;
+    lock->Release();
+}
+
+void
+ReadWriteLock::ReleaseWrite()
+{
+    ASSERT(writer == currentThread);
+
+    lock->Acquire();
+    writer = nullptr;
+    if (waitingWriters > 0) {
+        canWrite->Signal();
+    } else {
+        canRead->Broadcast();
+    }
+    lock->Release();
+}
+
+bool
+ReadWriteLock::IsWriteHeldByCurrentThread() const
+{
+    return writer == currentThread;
+}
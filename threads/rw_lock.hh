@@ -0,0 +1,57 @@
+/// Reader/writer lock, a synchronization primitive.
+///
+/// Any number of readers may hold the lock at the same time, but a writer
+/// holds it alone.
+///
+/// Copyright (c) 2016-2021 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_RWLOCK__HH
+#define NACHOS_THREADS_RWLOCK__HH
+
+
+#include "condition.hh"
+
+
+class Thread;
+
+/// This class defines a “reader/writer lock”.
+///
+/// * `AcquireRead` -- wait until no writer holds or waits for the lock, and
+///   join the readers.
+/// * `AcquireWrite` -- wait until nobody holds the lock, and take it.
+///
+/// Waiting writers keep new readers out, so a steady stream of readers
+/// cannot starve them.  The lock is not recursive: a thread holding it must
+/// not acquire it again.
+class ReadWriteLock {
+public:
+
+    /// Constructor: set up the lock as free.
+    ReadWriteLock(const char *debugName);
+
+    ~ReadWriteLock();
+
+    const char *GetName() const;
+
+    void AcquireRead();
+    void ReleaseRead();
+    void AcquireWrite();
+    void ReleaseWrite();
+
+    /// True if the current thread holds the lock as a writer.
+    bool IsWriteHeldByCurrentThread() const;
+
+private:
+    const char *name;
+    Lock *lock;  ///< Protects the fields below.
+    Condition *canRead;
+    Condition *canWrite;
+    unsigned readers;         ///< Threads holding the lock to read.
+    unsigned waitingWriters;  ///< Threads waiting in `AcquireWrite`.
+    Thread *writer;           ///< Thread holding the lock to write, if any.
+};
+
+
+#endif
@@ -123,9 +123,14 @@ Scheduler::Run(Thread *nextThread)
     // If the old thread gave up the processor because it was finishing, we
     // need to delete its carcass.  Note we cannot delete the thread before
     // now (for example, in `Thread::Finish`), because up to this point, we
-    // were still running on the old thread's stack!
+    // were still running on the old thread's stack!  A joinable thread
+    // only loses its stack; whoever joins it deletes the rest.
     if (threadToBeDestroyed != nullptr) {
-        delete threadToBeDestroyed;
+        if (threadToBeDestroyed->IsJoinable()) {
+            threadToBeDestroyed->ReleaseStack();
+        } else {
+            delete threadToBeDestroyed;
+        }
         threadToBeDestroyed = nullptr;
     }
 
@@ -75,11 +75,12 @@ Disk:\n\
     printf("\n\
 Filesystem:\n\
   Sectors per header: %u.\n\
+  Sectors per index block: %u.\n\
   Maximum file size: %u bytes.\n\
   File name maximum length: %u.\n\
   Free sectors map size: %u bytes.\n\
   Maximum number of dir-entries: %u.\n\
   Directory file size: %u bytes.\n",
-      NUM_DIRECT, MAX_FILE_SIZE, FILE_NAME_MAX_LEN, 
+      NUM_DIRECT, NUM_INDIRECT, MAX_FILE_SIZE, FILE_NAME_MAX_LEN, 
       FREE_MAP_FILE_SIZE, NUM_DIR_ENTRIES, DIRECTORY_FILE_SIZE);
 }
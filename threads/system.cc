@@ -20,6 +20,7 @@
 #ifdef SWAP
 #include "vmem/coremap.hh"
 #endif
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -40,11 +41,13 @@ FileSystem *fileSystem;
 
 #ifdef FILESYS
 SynchDisk *synchDisk;
+FileNodeTable *fileNodeTable;
 #endif
 
 #ifdef USER_PROGRAM  // Requires either *FILESYS* or *FILESYS_STUB*.
 Table<Thread *> *threadTable; ///< Table to keep track of threads.
 SynchConsole *synchConsole;   ///< Synchronized console.
+ExecutableCache *executableCache;  ///< Images of recent programs.
 Table<OpenFile *> *openFileTable; // Table of open files.
 Machine *machine;  ///< User program memory and registers.
 #ifdef SWAP
@@ -52,6 +55,9 @@ CoreMap *pages;
 #else
 Bitmap *pages;  ///< Bitmap of free pages.
 #endif
+#ifdef SWAP_POOL
+SwapPool *swapPool;  ///< Compressed cache of evicted pages.
+#endif
 
 #endif
 
@@ -139,6 +145,10 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
     int numPhysicalPages = DEFAULT_NUM_PHYS_PAGES;
+#ifdef SWAP_POOL
+    int swapPoolPages = DEFAULT_SWAP_POOL_PAGES;
+#endif
+    const char *pageTraceFile = nullptr;
     threadTable = new Table<Thread *>;  // Table to keep track of threads.
     
 #endif
@@ -176,6 +186,18 @@ Initialize(int argc, char **argv)
             numPhysicalPages = atoi(*(argv + 1));
             argCount = 2;
         }
+        if (!strcmp(*argv, "-pt")) {
+            ASSERT(argc > 1);
+            pageTraceFile = *(argv + 1);
+            argCount = 2;
+        }
+#ifdef SWAP_POOL
+        if (!strcmp(*argv, "-sp")) {
+            ASSERT(argc > 1);
+            swapPoolPages = atoi(*(argv + 1));
+            argCount = 2;
+        }
+#endif
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f")) {
@@ -195,6 +217,9 @@ Initialize(int argc, char **argv)
     #ifdef USER_PROGRAM
     #ifdef SWAP
     pages = new CoreMap(numPhysicalPages);
+    #ifdef SWAP_POOL
+    swapPool = new SwapPool(swapPoolPages * PAGE_SIZE);
+    #endif
     #else
     pages = new Bitmap(numPhysicalPages);
     #endif
@@ -213,12 +238,18 @@ Initialize(int argc, char **argv)
     Debugger *d = debugUserProg ? new Debugger : nullptr;
     
     machine = new Machine(d, numPhysicalPages);  // This must come first.
+    if (pageTraceFile != nullptr
+          && !machine->GetMMU()->StartTrace(pageTraceFile)) {
+        fprintf(stderr, "Cannot open page trace file %s\n", pageTraceFile);
+    }
     synchConsole = new SynchConsole();
+    executableCache = new ExecutableCache;
     SetExceptionHandlers();
 #endif
 
 #ifdef FILESYS
     synchDisk = new SynchDisk("DISK");
+    fileNodeTable = new FileNodeTable;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -234,6 +265,7 @@ Cleanup()
     DEBUG('i', "Cleaning up...\n");
 
 #ifdef USER_PROGRAM
+    delete executableCache;
     delete machine;
 #endif
 
@@ -242,6 +274,7 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete fileNodeTable;
     delete synchDisk;
 #endif
 
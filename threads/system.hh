@@ -16,7 +16,6 @@
 #include "machine/statistics.hh"
 #include "machine/timer.hh"
 
-#define READLIMIT 10
 
 
 /// Initialization and cleanup routines.
@@ -43,6 +42,10 @@ extern Timer *timer;                 ///< The hardware alarm clock.
 #ifdef SWAP
 #include "vmem/coremap.hh"
 #endif
+#ifdef SWAP_POOL
+#include "vmem/swap_pool.hh"
+#endif
+#include "userprog/executable_cache.hh"
 
 class SynchConsole;
 #ifndef SWAP
@@ -50,7 +53,11 @@ extern Bitmap *pages;
 #else
 extern CoreMap *pages;
 #endif
+#ifdef SWAP_POOL
+extern SwapPool *swapPool;           ///< Compressed cache of evicted pages.
+#endif
 extern SynchConsole *synchConsole;   ///< Synchronized console.
+extern ExecutableCache *executableCache;  ///< Images of recent programs.
 extern Machine *machine;  // User program memory and registers.
 extern Table<Thread *> *threadTable; ///< Table to keep track of threads.
 #endif
@@ -62,7 +69,9 @@ extern FileSystem *fileSystem;
 
 #ifdef FILESYS
 #include "filesys/synch_disk.hh"
+#include "filesys/file_node_table.hh"
 extern SynchDisk *synchDisk;
+extern FileNodeTable *fileNodeTable;  ///< Headers of open files.
 #endif
 
 #endif
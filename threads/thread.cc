@@ -20,6 +20,7 @@
 #include "thread.hh"
 #include "switch.h"
 #include "system.hh"
+#include "semaphore.hh"
 
 #include <inttypes.h>
 #include <stdio.h>
@@ -46,9 +47,17 @@ Thread::Thread(const char *threadName, const bool joinable, int priority) : m_jo
     stackTop = nullptr;
     stack    = nullptr;
     status   = JUST_CREATED;
+    m_joinSemaphore = joinable ? new Semaphore("join", 0) : nullptr;
+    m_joined = false;
+    m_detached = false;
+    m_finished = false;
+    m_exitStatus = 0;
 #ifdef USER_PROGRAM
     space    = nullptr;
-    openFileTable = new Table<OpenFile *>;
+    parentId = -1;
+    openFileTable = new Table<FileDescriptor *>(MAX_OPEN_FILES);
+    openFileTable->Add(new FileDescriptor(FileDescriptor::CONSOLE_INPUT_KIND));
+    openFileTable->Add(new FileDescriptor(FileDescriptor::CONSOLE_OUTPUT_KIND));
     pid = threadTable->Add(this);
 #endif
 }
@@ -66,13 +75,12 @@ Thread::~Thread()
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
-    if (stack != nullptr) {
-        SystemDep::DeallocBoundedArray((char *) stack,
-                                       STACK_SIZE * sizeof *stack);
-    }
+    ReleaseStack();
+    delete m_joinSemaphore;
     #ifdef USER_PROGRAM
         threadTable->Remove(pid);
         delete space;
+        CloseFiles();
         delete openFileTable;
     #endif
 }
@@ -109,19 +117,60 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     interrupt->SetLevel(oldLevel);
 }
 
-void
+int
 Thread::Join()
 {
-    ASSERT(m_joinable);
+    ASSERT(IsJoinable() && !m_joined);
+    ASSERT(this != currentThread);
+
+    m_joined = true;
+    m_joinSemaphore->P();  // Signalled by `Finish`.
+
+    // By the time the joiner runs again, the scheduler has already released
+    // the stack, so only the zombie is left.
+    int exitStatus = m_exitStatus;
+    delete this;
+    return exitStatus;
+}
+
+void
+Thread::Detach()
+{
+    ASSERT(IsJoinable() && !m_joined);
+    ASSERT(this != currentThread);
 
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
-    
-    while (status != FINISHED) {
-        currentThread->Sleep();
+    m_detached = true;  // From now on `Finish` leaves no zombie.
+    bool finished = m_finished;
+    interrupt->SetLevel(oldLevel);
+
+    if (finished) {
+        // The scheduler has already released the stack.
+        delete this;
     }
+}
 
-    interrupt->SetLevel(oldLevel);
+bool
+Thread::IsJoinable() const
+{
+    return m_joinable && !m_detached;
+}
 
+bool
+Thread::HasJoiner() const
+{
+    return m_joined;
+}
+
+void
+Thread::ReleaseStack()
+{
+    ASSERT(this != currentThread);
+    if (stack != nullptr) {
+        SystemDep::DeallocBoundedArray((char *) stack,
+                                       STACK_SIZE * sizeof *stack);
+        stack = nullptr;
+    }
 }
 
 /// Check a thread's stack to see if it has overrun the space that has been
@@ -196,16 +245,25 @@ Thread::Print() const
 ///
 /// NOTE: we disable interrupts, so that we do not get a time slice between
 /// setting `threadToBeDestroyed`, and going to sleep.
+///
+/// A joinable thread that was not detached only has its stack released;
+/// the rest is kept, with `status`, until some thread joins it.
 void
-Thread::Finish()
+Thread::Finish(int exitStatus)
 {
     interrupt->SetLevel(INT_OFF);
     ASSERT(this == currentThread);
 
-    DEBUG('t', "Finishing thread \"%s\"\n", GetName());
+    DEBUG('t', "Finishing thread \"%s\" with status %d\n",
+          GetName(), exitStatus);
 
     threadToBeDestroyed = currentThread;
-    if(m_joinable) SetStatus(FINISHED);
+    m_finished = true;
+    if (IsJoinable()) {
+        SetStatus(FINISHED);
+        m_exitStatus = exitStatus;
+        m_joinSemaphore->V();  // Wake the joiner, if any.
+    }
     Sleep();  // Invokes `SWITCH`.
     // Not reached.
 }
@@ -334,7 +392,7 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 /// Note that a user program thread has *two* sets of CPU registers -- one
 /// for its state while executing user code, one for its state while
 /// executing kernel code.  This routine saves the former.
-int Thread::AddFile(OpenFile *file)
+int Thread::AddFile(FileDescriptor *file)
 {
     ASSERT(file != nullptr);
     return openFileTable->Add(file);
@@ -343,16 +401,85 @@ int Thread::AddFile(OpenFile *file)
 bool Thread::RemoveFile(int id)
 {
     if (id < 0) return false;
-    openFileTable->Remove(id);
+    FileDescriptor *file = openFileTable->Remove(id);
+    if (file == nullptr) return false;
+    file->Release();
     return true;
 }
 
-OpenFile* Thread::GetFile(int id)
+FileDescriptor* Thread::GetFile(int id)
 {
     ASSERT(id >= 0);
     return openFileTable->Get(id);
 }
 
+int Thread::SetFile(int id, FileDescriptor *file)
+{
+    ASSERT(file != nullptr);
+    if (id < 0)
+        return -1;
+    file->Retain();
+    if (openFileTable->HasKey(id)) {
+        // Replace in place, so that `id` stays valid.
+        openFileTable->Update(id, file)->Release();
+        return id;
+    }
+    // Out of range, or a stale id for a slot now in use under a newer
+    // generation, fails; a free slot gets its own generation.
+    int newId = openFileTable->Insert(id, file);
+    if (newId == -1)
+        file->Release();
+    return newId;
+}
+
+void Thread::InheritFiles(Thread *parent)
+{
+    ASSERT(parent != nullptr);
+    CloseFiles();
+    openFileTable->CopyFrom(*parent->openFileTable);
+    for (unsigned i = 0; i < openFileTable->Capacity(); i++) {
+        int id = openFileTable->IdAt(i);
+        if (id != -1) {
+            openFileTable->Get(id)->Retain();
+        }
+    }
+}
+
+void Thread::SetParent(Thread *parent)
+{
+    ASSERT(parent != nullptr);
+    parentId = parent->pid;
+}
+
+void Thread::DetachChildren()
+{
+    for (unsigned i = 0; i < threadTable->Capacity(); i++) {
+        int id = threadTable->IdAt(i);
+        if (id == -1) {
+            continue;
+        }
+        Thread *child = threadTable->Get(id);
+        if (child->parentId != pid) {
+            continue;
+        }
+        child->parentId = -1;
+        // A child being joined is deleted by its joiner.
+        if (child->IsJoinable() && !child->HasJoiner()) {
+            child->Detach();
+        }
+    }
+}
+
+void Thread::CloseFiles()
+{
+    for (unsigned i = 0; i < openFileTable->Capacity(); i++) {
+        int id = openFileTable->IdAt(i);
+        if (id != -1) {
+            RemoveFile(id);
+        }
+    }
+}
+
 void
 Thread::SaveUserState()
 {
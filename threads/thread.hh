@@ -46,6 +46,7 @@
 #include "userprog/address_space.hh"
 #include "filesys/open_file.hh"
 #include "filesys/file_system.hh"
+#include "userprog/file_descriptor.hh"
 #include "lib/table.hh"
 #endif
 
@@ -64,6 +65,9 @@ const unsigned MACHINE_STATE_SIZE = 17;
 /// WATCH OUT IF THIS IS NOT BIG ENOUGH!!!!!
 const unsigned STACK_SIZE = 4 * 1024;
 
+/// Maximum number of files a user program can have open at once.
+const unsigned MAX_OPEN_FILES = 1024;
+
 class Semaphore;
 
 /// Thread state.
@@ -113,7 +117,24 @@ public:
     /// Make thread run `(*func)(arg)`.
     void Fork(VoidFunctionPtr func, void *arg);
 
-    void Join();
+    /// Wait for the thread to finish and return its exit status.
+    ///
+    /// The thread must be joinable.  A joinable thread that finishes gives
+    /// back its stack right away, but the `Thread` object stays around as
+    /// a zombie holding the exit status until it is joined; `Join` then
+    /// deletes it, so a thread can be joined only once.
+    int Join();
+
+    /// Give up on joining the thread.  A zombie is deleted right away, and
+    /// a thread still running is deleted as soon as it finishes.
+    void Detach();
+
+    /// Check whether the thread can still be joined, that is, it was
+    /// created joinable and has not been detached.
+    bool IsJoinable() const;
+
+    /// Check whether some thread is already waiting in `Join`.
+    bool HasJoiner() const;
 
     /// Relinquish the CPU if any other thread is runnable.
     void Yield();
@@ -121,8 +142,12 @@ public:
     /// Put the thread to sleep and relinquish the processor.
     void Sleep();
 
-    /// The thread is done executing.
-    void Finish();
+    /// The thread is done executing, with exit status `status`.
+    void Finish(int status = 0);
+
+    /// Free the stack of a finished joinable thread.  Called by the
+    /// scheduler, once it runs on another stack.
+    void ReleaseStack();
 
     /// Check if thread has overflowed its stack.
     void CheckOverflow() const;
@@ -151,7 +176,11 @@ private:
     const char *name;
 
     const bool m_joinable;
-    Semaphore *m_joinSemaphore;
+    Semaphore *m_joinSemaphore;  ///< Signalled when the thread finishes.
+    bool m_joined;
+    bool m_detached;
+    bool m_finished;
+    int m_exitStatus;
 
     int m_priority;
 
@@ -166,17 +195,39 @@ private:
     /// state while executing kernel code.
     int userRegisters[NUM_TOTAL_REGS];
     
-    Table<OpenFile *> *openFileTable; // Table of open files.
+    /// Table of open files, indexed by the ids user programs see.  Ids 0
+    /// and 1 start out as the console.
+    Table<FileDescriptor *> *openFileTable;
     int pid;
+
+    /// Id of the thread that started this one with `Exec`, or -1.
+    int parentId;
 public:
     // Add a file to the open file table.
-    int AddFile(OpenFile *file);
+    int AddFile(FileDescriptor *file);
 
     // Remove a file from the open file table.
     bool RemoveFile(int id);
 
     // Get a file from the open file table.
-    OpenFile *GetFile(int id);
+    FileDescriptor *GetFile(int id);
+
+    // Install `file` under `id`, closing whatever was there.  Returns the
+    // id it ends up under, or -1 on error.
+    int SetFile(int id, FileDescriptor *file);
+
+    // Replace the open file table with a copy of the one of `parent`.
+    void InheritFiles(Thread *parent);
+
+    // Record `parent` as the thread that started this one.
+    void SetParent(Thread *parent);
+
+    // Detach every child nobody is joining yet, so that zombies of
+    // programs that will never be joined do not outlive their parent.
+    void DetachChildren();
+
+    // Close every open file.
+    void CloseFiles();
 
     // Save user-level register state.
     void SaveUserState();
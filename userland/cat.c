@@ -3,6 +3,9 @@
 #define ARGC_ERROR    "Error: missing argument."
 #define CREATE_ERROR  "Error: could not create file."
 
+/// Kept out of the stack, which is small.
+static char buffer[4096];
+
 int
 main(int argc, char *argv[])
 {
@@ -18,10 +21,9 @@ main(int argc, char *argv[])
             Write("Cannot open file.", 18, CONSOLE_OUTPUT);
             return 1;
         }
-        char buf[1];
-        
-        while(Read(buf, 1, fd)){
-            Write(buf, 1, CONSOLE_OUTPUT);
+        int n;
+        while((n = Read(buffer, sizeof buffer, fd)) > 0){
+            Write(buffer, n, CONSOLE_OUTPUT);
         }
         Write("\n", 1, CONSOLE_OUTPUT);
         Close(fd);
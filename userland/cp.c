@@ -1,6 +1,9 @@
 #include "syscall.h"
 #include "lib.h"
 
+/// Kept out of the stack, which is small.
+static char buffer[4096];
+
 static inline void
 WriteError(const char *description, OpenFileId output)
 {
@@ -9,9 +12,12 @@ WriteError(const char *description, OpenFileId output)
     static const char PREFIX[] = "Error: ";
     static const char SUFFIX[] = "\n";
 
-    Write(PREFIX, sizeof PREFIX - 1, output);
-    Write(description, strlen(description), output);
-    Write(SUFFIX, sizeof SUFFIX - 1, output);
+    IoVec vec[3] = {
+        { (void *) PREFIX, sizeof PREFIX - 1 },
+        { (void *) description, strlen(description) },
+        { (void *) SUFFIX, sizeof SUFFIX - 1 }
+    };
+    WriteV(vec, 3, output);
 }
 
 int main(int argc, char* argv[]){
@@ -36,8 +42,7 @@ int main(int argc, char* argv[]){
 
 
     for(;;){
-        char buffer[1];
-        int n = Read(buffer, 1, fd);
+        int n = Read(buffer, sizeof buffer, fd);
         if(n <= 0){
             break;
         }
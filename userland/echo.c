@@ -31,9 +31,28 @@ PrintChar(char c)
 int
 main(int argc, char *argv[])
 {
-    char buff[5];
-    Read(buff, 4, CONSOLE_INPUT);
-    Write(buff, 4, CONSOLE_OUTPUT);
+    // Send the arguments, with the separators, in as few system calls as
+    // `IOV_MAX` allows.
+    IoVec vec[IOV_MAX];
+    int count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (count + 3 > IOV_MAX) {
+            WriteV(vec, count, CONSOLE_OUTPUT);
+            count = 0;
+        }
+        if (i > 1) {
+            vec[count].buffer = " ";
+            vec[count].length = 1;
+            count++;
+        }
+        vec[count].buffer = argv[i];
+        vec[count].length = StringLength(argv[i]);
+        count++;
+    }
+    vec[count].buffer = "\n";
+    vec[count].length = 1;
+    count++;
+    WriteV(vec, count, CONSOLE_OUTPUT);
 
     return 0;
 }
@@ -31,9 +31,12 @@ WriteError(const char *description, OpenFileId output)
     static const char PREFIX[] = "Error: ";
     static const char SUFFIX[] = "\n";
 
-    Write(PREFIX, sizeof PREFIX - 1, output);
-    Write(description, strlen(description), output);
-    Write(SUFFIX, sizeof SUFFIX - 1, output);
+    IoVec vec[3] = {
+        { (void *) PREFIX, sizeof PREFIX - 1 },
+        { (void *) description, strlen(description) },
+        { (void *) SUFFIX, sizeof SUFFIX - 1 }
+    };
+    WriteV(vec, 3, output);
 }
 
 static unsigned
@@ -96,6 +99,55 @@ PrepareArguments(char *line, char **argv, unsigned argvSize)
     return 1;
 }
 
+/// Find a `|` argument, split `argv` there and return the index of the
+/// first argument of the second command; return 0 if there is no pipe.
+static unsigned
+SplitPipeline(char **argv)
+{
+    for (unsigned i = 1; argv[i] != NULL; i++) {
+        if (argv[i][0] == '|' && argv[i][1] == '\0') {
+            argv[i] = NULL;
+            return argv[i + 1] != NULL ? i + 1 : 0;
+        }
+    }
+    return 0;
+}
+
+/// Run `left | right`: the output of the first program becomes the input
+/// of the second one.  Both programs inherit the ids of the shell, so the
+/// pipe ends are installed as console ids while each of them is started.
+static void
+RunPipeline(char **left, char **right, OpenFileId input, OpenFileId output)
+{
+    OpenFileId ends[2];
+    if (Pipe(ends) < 0) {
+        WriteError("cannot create pipe.", output);
+        return;
+    }
+    const OpenFileId savedInput  = Dup(input);
+    const OpenFileId savedOutput = Dup(output);
+
+    Dup2(ends[1], output);
+    const SpaceId writer = Exec(left[0], left);
+    Dup2(savedOutput, output);
+
+    Dup2(ends[0], input);
+    const SpaceId reader = Exec(right[0], right);
+    Dup2(savedInput, input);
+
+    // The shell must let go of the pipe, so that the reader sees the end
+    // of the data once the writer is done.
+    Close(ends[0]);
+    Close(ends[1]);
+    Close(savedInput);
+    Close(savedOutput);
+
+    if ((writer >= 0 && Join(writer) < 0)
+          || (reader >= 0 && Join(reader) < 0)) {
+        WriteError("error joining process.", output);
+    }
+}
+
 int
 main(void)
 {
@@ -116,6 +168,12 @@ main(void)
             continue;
         }
 
+        const unsigned second = SplitPipeline(argv);
+        if (second != 0) {
+            RunPipeline(argv, &argv[second], INPUT, OUTPUT);
+            continue;
+        }
+
         int cantJoin = line[0] == '&';
 
         // Comment and uncomment according to whether command line arguments
@@ -133,6 +133,118 @@ Close:
         j       $31
         .end    Close
 
+        .globl  Mmap
+        .ent    Mmap
+Mmap:
+        addiu   $2, $0, SC_MMAP
+        syscall
+        j       $31
+        .end    Mmap
+
+        .globl  Munmap
+        .ent    Munmap
+Munmap:
+        addiu   $2, $0, SC_MUNMAP
+        syscall
+        j       $31
+        .end    Munmap
+
+        .globl  ReadV
+        .ent    ReadV
+ReadV:
+        addiu   $2, $0, SC_READV
+        syscall
+        j       $31
+        .end    ReadV
+
+        .globl  WriteV
+        .ent    WriteV
+WriteV:
+        addiu   $2, $0, SC_WRITEV
+        syscall
+        j       $31
+        .end    WriteV
+
+        .globl  Enter
+        .ent    Enter
+Enter:
+        addiu   $2, $0, SC_ENTER
+        syscall
+        j       $31
+        .end    Enter
+
+        .globl  Pipe
+        .ent    Pipe
+Pipe:
+        addiu   $2, $0, SC_PIPE
+        syscall
+        j       $31
+        .end    Pipe
+
+        .globl  Dup
+        .ent    Dup
+Dup:
+        addiu   $2, $0, SC_DUP
+        syscall
+        j       $31
+        .end    Dup
+
+        .globl  Dup2
+        .ent    Dup2
+Dup2:
+        addiu   $2, $0, SC_DUP2
+        syscall
+        j       $31
+        .end    Dup2
+
+        .globl  SetNonBlocking
+        .ent    SetNonBlocking
+SetNonBlocking:
+        addiu   $2, $0, SC_SETNONBLOCKING
+        syscall
+        j       $31
+        .end    SetNonBlocking
+
+        .globl  Sync
+        .ent    Sync
+Sync:
+        addiu   $2, $0, SC_SYNC
+        syscall
+        j       $31
+        .end    Sync
+
+        .globl  Mkdir
+        .ent    Mkdir
+Mkdir:
+        addiu   $2, $0, SC_MKDIR
+        syscall
+        j       $31
+        .end    Mkdir
+
+        .globl  Rmdir
+        .ent    Rmdir
+Rmdir:
+        addiu   $2, $0, SC_RMDIR
+        syscall
+        j       $31
+        .end    Rmdir
+
+        .globl  ListDir
+        .ent    ListDir
+ListDir:
+        addiu   $2, $0, SC_LISTDIR
+        syscall
+        j       $31
+        .end    ListDir
+
+        .globl  Poll
+        .ent    Poll
+Poll:
+        addiu   $2, $0, SC_POLL
+        syscall
+        j       $31
+        .end    Poll
+
 /// Dummy function to keep gcc happy.
         .globl  __main
         .ent    __main
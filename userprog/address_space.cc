@@ -11,6 +11,7 @@
 #include "threads/system.hh"
 #include "machine/system_dep.hh"
 #include <string.h>
+#include <stdint.h>
 #include <cstdio>
 
 unsigned int 
@@ -24,14 +25,19 @@ AddressSpace::TranlateAddress(unsigned int virtualAddr){
 /// First, set up the translation from program memory to physical memory.
 /// For now, this is really simple (1:1), since we are only uniprogramming,
 /// and we have a single unsegmented page table.
-AddressSpace::AddressSpace(OpenFile *executable_file, int _pid) : pid(_pid)
+AddressSpace::AddressSpace(Executable *executable, int _pid) : pid(_pid)
 {
-    ASSERT(executable_file != nullptr);
+    ASSERT(executable != nullptr);
     #ifdef SWAP
     head = 0;
+    diskSpace = nullptr;
     #endif
-    exe = new Executable(executable_file);
-    ASSERT(exe->CheckMagic());
+    #ifdef DEMAND_LOADING
+    for (unsigned i = 0; i < MAX_MAPPED_FILES; i++) {
+        mappedFiles[i].file = nullptr;
+    }
+    #endif
+    exe = executable;
 
     // How big is address space?
 
@@ -54,9 +60,14 @@ AddressSpace::AddressSpace(OpenFile *executable_file, int _pid) : pid(_pid)
     
     #ifdef SWAP
       swapMap = new Bitmap(numPages);
+      zeroMap = new Bitmap(numPages);
     #endif
 
     pageTable = new TranslationEntry[numPages];
+    #ifdef DEMAND_LOADING
+      mapBase = numPages;
+      tableSize = numPages;
+    #endif
     for (unsigned i = 0; i < numPages; i++) {
         pageTable[i].virtualPage  = i;
         #ifdef USER_PROGRAM
@@ -143,9 +154,6 @@ AddressSpace::AddressSpace(OpenFile *executable_file, int _pid) : pid(_pid)
 
 #ifdef DEMAND_LOADING
 void AddressSpace::LoadPage(int page){
-    // exe = new Executable(executableFile);
-    ASSERT(exe->CheckMagic());
-    
     char *mainMemory = machine->mainMemory;
     #ifdef SWAP
     int physicalPage = pages->Find(page, pid);
@@ -166,14 +174,33 @@ void AddressSpace::LoadPage(int page){
         #endif
     }
 
+    MappedFile *m = FindMapping(page);
+    if (m != nullptr) {
+        LoadMappedPage(m, page, physicalPage);
+        return;
+    }
+
 
 #ifdef SWAP
-    if(swapMap->Test(page)){
-      DEBUG('f', "Loading page %d from SWAP to physical page %d\n", page, physicalPage);
-      diskSpace->ReadAt(&mainMemory[physicalPage * PAGE_SIZE], PAGE_SIZE, page * PAGE_SIZE);
+    if(zeroMap->Test(page)){
+      DEBUG('f', "Zero-filling page %d in physical page %d\n", page, physicalPage);
+      memset(&mainMemory[physicalPage * PAGE_SIZE], 0, PAGE_SIZE);
+      zeroMap->Clear(page);
+      pageTable[page].physicalPage = physicalPage;
+      pageTable[page].valid = true;
+    }else if(swapMap->Test(page)){
+#ifdef SWAP_POOL
+      if (swapPool->Load(pid, page, &mainMemory[physicalPage * PAGE_SIZE])) {
+        DEBUG('f', "Loading page %d from swap pool to physical page %d\n", page, physicalPage);
+      } else
+#endif
+      {
+        DEBUG('f', "Loading page %d from SWAP to physical page %d\n", page, physicalPage);
+        diskSpace->ReadAt(&mainMemory[physicalPage * PAGE_SIZE], PAGE_SIZE, page * PAGE_SIZE);
+        stats->readFromSwap++;
+      }
       pageTable[page].physicalPage = physicalPage;
       pageTable[page].valid = true;
-      stats->readFromSwap++;
     }else
 #endif
     {
@@ -219,14 +246,29 @@ void AddressSpace::LoadPage(int page){
     
 }
 #ifdef SWAP
-void AddressSpace::Swap(int physical, int vpn){
-    if(diskSpace == nullptr){
-        DEBUG('e', "Creating swap file for process %d\n", pid);
-        char spaceName[10];
-        sprintf(spaceName, "SWAP.%d", pid);
-        ASSERT(fileSystem->Create(spaceName, numPages * PAGE_SIZE));
-        ASSERT(diskSpace = fileSystem->Open(spaceName));
+/// Size of the name of a swap file: `SWAP.` and a process id.
+static const unsigned SWAP_NAME_SIZE = 16;
+
+/// Write the name of the swap file of process `pid` into `name`.
+static void
+SwapFileName(char *name, int pid)
+{
+    snprintf(name, SWAP_NAME_SIZE, "SWAP.%d", pid);
+}
+
+/// Check whether a page only holds zeroes, a word at a time.
+static bool
+IsZeroPage(const char *page)
+{
+    const uint64_t *words = (const uint64_t *) page;
+    uint64_t acc = 0;
+    for (unsigned i = 0; i < PAGE_SIZE / sizeof *words; i++) {
+        acc |= words[i];
     }
+    return acc == 0;
+}
+
+void AddressSpace::Swap(int physical, int vpn){
     if(currentThread->space == this){
       TranslationEntry* tlb = machine->GetMMU()->tlb;
       for(unsigned i = 0; i < TLB_SIZE; i++){
@@ -237,8 +279,47 @@ void AddressSpace::Swap(int physical, int vpn){
       }
     }
 
+    // Pages of mapped files go back to their file instead of the swap.
+    MappedFile *m = FindMapping(vpn);
+    if (m != nullptr) {
+        if (pageTable[vpn].dirty) {
+            WriteBackMappedPage(m, vpn, physical);
+        }
+        pageTable[vpn].valid = false;
+        return;
+    }
+
+    char* mainMemory = machine->mainMemory;
+    if (IsZeroPage(&mainMemory[physical * PAGE_SIZE])) {
+        DEBUG('f', "Page %d (physical address %d) is all zeroes, not swapped\n", vpn, physical);
+        pageTable[vpn].valid = false;
+        zeroMap->Mark(vpn);
+  #ifdef SWAP_POOL
+        swapPool->Discard(pid, vpn);  // An older copy is of no use now.
+  #endif
+        stats->zeroPagesSkipped++;
+        return;
+    }
+    zeroMap->Clear(vpn);
+
+#ifdef SWAP_POOL
+    // Keep the page compressed in memory while there is room.
+    if (swapPool->Store(pid, vpn, &mainMemory[physical * PAGE_SIZE])) {
+        pageTable[vpn].valid = false;
+        swapMap->Mark(vpn);
+        return;
+    }
+#endif
+
+    if(diskSpace == nullptr){
+        DEBUG('e', "Creating swap file for process %d\n", pid);
+        char spaceName[SWAP_NAME_SIZE];
+        SwapFileName(spaceName, pid);
+        ASSERT(fileSystem->Create(spaceName, numPages * PAGE_SIZE));
+        ASSERT(diskSpace = fileSystem->Open(spaceName));
+    }
+
     // if(pageTable[vpn].dirty || !swapMap->Test(vpn)){
-      char* mainMemory = machine->mainMemory;
       DEBUG('f', "Writing page %d (physical address %d) to SWAP\n", vpn, physical);
       diskSpace->WriteAt(&mainMemory[physical * PAGE_SIZE], PAGE_SIZE, vpn * PAGE_SIZE);
       pageTable[vpn].valid = false;
@@ -248,14 +329,20 @@ void AddressSpace::Swap(int physical, int vpn){
 }
 
 int AddressSpace::PickVictim(){
-  int r;
+  int r = -1;
   #ifdef PRPOLICY_FIFO
-    r = head;
-    head = (head+1)%machine->GetNumPhysicalPages();
+    for(unsigned tries = 0; r == -1 || pages->IsPinned(r); tries++){
+      ASSERT(tries < machine->GetNumPhysicalPages());
+      r = head;
+      head = (head+1)%machine->GetNumPhysicalPages();
+    }
   #endif
   #ifdef PRPOLICY_CLOCK
     for(int ronda = 0; ronda < 4; ronda++){
       for(int i = head; i < head + machine->GetNumPhysicalPages(); i++){
+          if(pages->IsPinned(i % machine->GetNumPhysicalPages())){
+            continue;
+          }
           int* check = pages->getFrame(i % machine->GetNumPhysicalPages());
           int checkVPN = check[0];
           int checkPID = check[1];
@@ -296,19 +383,367 @@ int AddressSpace::PickVictim(){
     }
   #endif
   #ifdef PRPOLICY_RANDOM
-    r = SystemDep::Random() % machine->GetNumPhysicalPages();
+    // Start at a random frame and give up after one full pass.
+    unsigned start = SystemDep::Random() % machine->GetNumPhysicalPages();
+    for (unsigned i = 0; r == -1 && i < machine->GetNumPhysicalPages(); i++){
+      unsigned frame = (start + i) % machine->GetNumPhysicalPages();
+      if (!pages->IsPinned(frame)) {
+        r = frame;
+      }
+    }
   #endif
+  ASSERT(r != -1);  // Every frame is pinned.
   return r;
 }
 
 #endif
 
+AddressSpace::MappedFile *
+AddressSpace::FindMapping(unsigned vpn)
+{
+    for (unsigned i = 0; i < MAX_MAPPED_FILES; i++) {
+        MappedFile *m = &mappedFiles[i];
+        if (m->file != nullptr
+              && vpn >= m->firstPage && vpn < m->firstPage + m->numPages) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+void
+AddressSpace::LoadMappedPage(MappedFile *m, unsigned vpn, unsigned physical)
+{
+    ASSERT(m != nullptr);
+
+    char *frame = &machine->mainMemory[physical * PAGE_SIZE];
+    unsigned pageOffset = (vpn - m->firstPage) * PAGE_SIZE;
+    unsigned count = m->size - pageOffset < PAGE_SIZE
+                     ? m->size - pageOffset : PAGE_SIZE;
+
+    DEBUG('a', "Loading page %u of mapped file into physical page %u\n",
+          vpn, physical);
+    memset(frame, 0, PAGE_SIZE);
+    m->file->ReadAt(frame, count, m->offset + pageOffset);
+
+    pageTable[vpn].physicalPage = physical;
+    pageTable[vpn].valid = true;
+    pageTable[vpn].use = false;
+    pageTable[vpn].dirty = false;
+}
+
+void
+AddressSpace::WriteBackMappedPage(MappedFile *m, unsigned vpn,
+                                  unsigned physical)
+{
+    ASSERT(m != nullptr);
+
+    unsigned pageOffset = (vpn - m->firstPage) * PAGE_SIZE;
+    unsigned count = m->size - pageOffset < PAGE_SIZE
+                     ? m->size - pageOffset : PAGE_SIZE;
+
+    DEBUG('a', "Writing page %u (physical page %u) back to mapped file\n",
+          vpn, physical);
+    m->file->WriteAt(&machine->mainMemory[physical * PAGE_SIZE], count,
+                     m->offset + pageOffset);
+    m->descriptor->NoteWrite();
+    pageTable[vpn].dirty = false;
+}
+
+unsigned
+AddressSpace::FindMappingSpace(unsigned count)
+{
+    // A free run can only start at `mapBase` or right after a region.
+    unsigned best = numPages;
+    for (unsigned i = 0; i <= MAX_MAPPED_FILES; i++) {
+        unsigned start;
+        if (i == MAX_MAPPED_FILES) {
+            start = mapBase;
+        } else if (mappedFiles[i].file != nullptr) {
+            start = mappedFiles[i].firstPage + mappedFiles[i].numPages;
+        } else {
+            continue;
+        }
+        if (start >= best) {
+            continue;
+        }
+        bool available = true;
+        for (unsigned j = 0; j < MAX_MAPPED_FILES && available; j++) {
+            const MappedFile *m = &mappedFiles[j];
+            available = m->file == nullptr || m->firstPage >= start + count
+                   || m->firstPage + m->numPages <= start;
+        }
+        if (available) {
+            best = start;
+        }
+    }
+    return best;
+}
+
+int
+AddressSpace::MapFile(FileDescriptor *descriptor, unsigned offset,
+                      unsigned size)
+{
+    ASSERT(descriptor != nullptr);
+    OpenFile *file = descriptor->GetFile();
+    ASSERT(file != nullptr);
+
+    // This also turns away negative sizes coming from user programs.
+    unsigned length = file->Length();
+    if (size == 0 || size > MAX_MAPPED_SIZE || offset % PAGE_SIZE != 0
+          || offset > length || size > length - offset) {
+        return -1;
+    }
+
+    MappedFile *m = nullptr;
+    for (unsigned i = 0; i < MAX_MAPPED_FILES; i++) {
+        if (mappedFiles[i].file == nullptr) {
+            m = &mappedFiles[i];
+            break;
+        }
+    }
+    if (m == nullptr) {
+        DEBUG('a', "No free slot to map another file.\n");
+        return -1;
+    }
+
+    unsigned regionPages = DivRoundUp(size, PAGE_SIZE);
+    unsigned firstPage = FindMappingSpace(regionPages);
+    unsigned end = firstPage + regionPages;
+
+    // Grow the page table if needed; the new pages stay invalid until
+    // touched.  Pages freed by `UnmapFile` are already invalid.
+    if (end > tableSize) {
+        TranslationEntry *newTable = new TranslationEntry[end];
+        for (unsigned i = 0; i < numPages; i++) {
+            newTable[i] = pageTable[i];
+        }
+        delete [] pageTable;
+        pageTable = newTable;
+        tableSize = end;
+    }
+    for (unsigned i = numPages; i < end; i++) {
+        pageTable[i].virtualPage  = i;
+        pageTable[i].physicalPage = -1;
+        pageTable[i].valid        = false;
+        pageTable[i].use          = false;
+        pageTable[i].dirty        = false;
+        pageTable[i].readOnly     = false;
+    }
+    if (end > numPages) {
+        numPages = end;
+    }
+
+    descriptor->Retain();  // Keep the file open while it is mapped.
+    m->descriptor = descriptor;
+    m->file      = file;
+    m->offset    = offset;
+    m->size      = size;
+    m->firstPage = firstPage;
+    m->numPages  = regionPages;
+
+  #ifndef USE_TLB
+    if (currentThread->space == this) {
+        RestoreState();
+    }
+  #endif
+
+    DEBUG('a', "Mapped %u bytes at offset %u to pages %u-%u\n",
+          size, offset, firstPage, end - 1);
+    return firstPage * PAGE_SIZE;
+}
+
+bool
+AddressSpace::UnmapFile(unsigned addr)
+{
+    if (addr % PAGE_SIZE != 0) {
+        return false;
+    }
+    MappedFile *m = FindMapping(addr / PAGE_SIZE);
+    if (m == nullptr || m->firstPage != addr / PAGE_SIZE) {
+        return false;
+    }
+
+    unsigned lastPage = m->firstPage + m->numPages;
+
+  #ifdef USE_TLB
+    // The TLB may hold more recent `use` and `dirty` bits.
+    if (currentThread->space == this) {
+        TranslationEntry *tlb = machine->GetMMU()->tlb;
+        for (unsigned i = 0; i < TLB_SIZE; i++) {
+            if (tlb[i].valid && tlb[i].virtualPage >= m->firstPage
+                  && tlb[i].virtualPage < lastPage) {
+                pageTable[tlb[i].virtualPage] = tlb[i];
+                tlb[i].valid = false;
+            }
+        }
+    }
+  #endif
+
+    for (unsigned vpn = m->firstPage; vpn < lastPage; vpn++) {
+        if (!pageTable[vpn].valid) {
+            continue;
+        }
+        if (pageTable[vpn].dirty) {
+            WriteBackMappedPage(m, vpn, pageTable[vpn].physicalPage);
+        }
+        pages->Clear(pageTable[vpn].physicalPage);
+        pageTable[vpn].valid = false;
+    }
+
+    m->descriptor->Release();
+    m->descriptor = nullptr;
+    m->file = nullptr;
+
+    // Give back the virtual pages past the last region left; holes between
+    // regions are reused by `MapFile`.
+    numPages = mapBase;
+    for (unsigned i = 0; i < MAX_MAPPED_FILES; i++) {
+        const MappedFile *r = &mappedFiles[i];
+        if (r->file != nullptr && r->firstPage + r->numPages > numPages) {
+            numPages = r->firstPage + r->numPages;
+        }
+    }
+
+  #ifndef USE_TLB
+    if (currentThread->space == this) {
+        RestoreState();
+    }
+  #endif
+    return true;
+}
+
 #endif
+
+bool
+AddressSpace::HasPage(unsigned vpn)
+{
+    if (vpn >= numPages) {
+        return false;
+    }
+  #ifdef DEMAND_LOADING
+    return vpn < mapBase || FindMapping(vpn) != nullptr;
+  #else
+    return true;
+  #endif
+}
+
+bool
+AddressSpace::PinRange(unsigned addr, unsigned size)
+{
+    if (size == 0) {
+        return true;
+    }
+    unsigned first = addr / PAGE_SIZE;
+    unsigned last = (addr + size - 1) / PAGE_SIZE;
+    if (addr + size < addr) {
+        return false;
+    }
+    for (unsigned vpn = first; vpn <= last; vpn++) {
+        if (!HasPage(vpn)) {
+            return false;
+        }
+    }
+
+    for (unsigned vpn = first; vpn <= last; vpn++) {
+    #ifdef DEMAND_LOADING
+        if (!pageTable[vpn].valid) {
+            DEBUG('e', "Loading page %u to pin it.\n", vpn);
+            stats->numPageFaults++;
+            LoadPage(vpn);
+        }
+    #endif
+    #ifdef SWAP
+        // Pages pinned so far stay in memory while the next ones are
+        // loaded.
+        pages->Pin(pageTable[vpn].physicalPage);
+    #endif
+    }
+    return true;
+}
+
+void
+AddressSpace::UnpinRange(unsigned addr, unsigned size)
+{
+    if (size == 0) {
+        return;
+    }
+    unsigned first = addr / PAGE_SIZE;
+    unsigned last = (addr + size - 1) / PAGE_SIZE;
+    ASSERT(last < numPages);
+
+    for (unsigned vpn = first; vpn <= last; vpn++) {
+        ASSERT(pageTable[vpn].valid);
+    #ifdef SWAP
+        pages->Unpin(pageTable[vpn].physicalPage);
+    #endif
+    }
+}
+
+unsigned
+AddressSpace::PinnedToPhysical(unsigned addr, bool writing)
+{
+    unsigned vpn = addr / PAGE_SIZE;
+    ASSERT(vpn < numPages);
+    ASSERT(pageTable[vpn].valid);
+
+    pageTable[vpn].use = true;
+    if (writing) {
+        pageTable[vpn].dirty = true;
+    }
+  #ifdef USE_TLB
+    // The TLB entry is copied back over the page table when it is dropped,
+    // so it must carry the same bits.
+    if (currentThread->space == this) {
+        TranslationEntry *tlb = machine->GetMMU()->tlb;
+        for (unsigned i = 0; i < TLB_SIZE; i++) {
+            if (tlb[i].valid && tlb[i].virtualPage == vpn) {
+                tlb[i].use = true;
+                if (writing) {
+                    tlb[i].dirty = true;
+                }
+            }
+        }
+    }
+  #endif
+    return pageTable[vpn].physicalPage * PAGE_SIZE + addr % PAGE_SIZE;
+}
+
 /// Deallocate an address space.
 ///
-/// Nothing for now!
+/// Modified pages of mapped files are written back before the frames are
+/// released.
 AddressSpace::~AddressSpace()
 {
+    #ifdef USE_TLB
+      // The TLB may hold more recent `use` and `dirty` bits, and must not
+      // keep translations to frames given back below.  `Cleanup` deletes
+      // the last thread with no current thread.
+      if (currentThread != nullptr && currentThread->space == this) {
+          TranslationEntry *tlb = machine->GetMMU()->tlb;
+          for (unsigned i = 0; i < TLB_SIZE; i++) {
+              if (tlb[i].valid) {
+                  pageTable[tlb[i].virtualPage] = tlb[i];
+                  tlb[i].valid = false;
+              }
+          }
+      }
+    #endif
+    #ifdef DEMAND_LOADING
+      for (unsigned i = 0; i < MAX_MAPPED_FILES; i++) {
+          MappedFile *m = &mappedFiles[i];
+          if (m->file == nullptr) {
+              continue;
+          }
+          for (unsigned vpn = m->firstPage;
+               vpn < m->firstPage + m->numPages; vpn++) {
+              if (pageTable[vpn].valid && pageTable[vpn].dirty) {
+                  WriteBackMappedPage(m, vpn, pageTable[vpn].physicalPage);
+              }
+          }
+          m->descriptor->Release();
+      }
+    #endif
     #ifdef USER_PROGRAM
       for (unsigned i = 0; i < numPages; i++) {
           if(pageTable[i].valid)
@@ -318,9 +753,17 @@ AddressSpace::~AddressSpace()
     #ifdef SWAP
       if(diskSpace != nullptr){
         delete diskSpace;
+        char spaceName[SWAP_NAME_SIZE];
+        SwapFileName(spaceName, pid);
+        fileSystem->Remove(spaceName);
       }
+      delete swapMap;
+      delete zeroMap;
+    #endif
+    #ifdef SWAP_POOL
+      swapPool->DiscardAll(pid);
     #endif
-    delete exe;
+    exe->Release();
     delete [] pageTable;
 }
 
@@ -17,24 +17,32 @@
 #include "filesys/file_system.hh"
 #include "machine/translation_entry.hh"
 #include "executable.hh"
+#include "file_descriptor.hh"
 #include "lib/bitmap.hh"
 const unsigned USER_STACK_SIZE = 1024;  ///< Increase this as necessary!
 
+/// Maximum number of files that can be mapped at the same time into a
+/// single address space.
+const unsigned MAX_MAPPED_FILES = 8;
+
+/// Maximum number of bytes of a single mapping.
+const unsigned MAX_MAPPED_SIZE = 64 * 1024;
+
 
 class AddressSpace {
 public:
 
     /// Create an address space to run a user program.
     ///
-    /// The address space is initialized from an already opened file.
-    /// The program contained in the file is loaded into memory and
-    /// everything is set up so that user instructions can start to be
-    /// executed.
+    /// The address space is initialized from an already loaded executable.
+    /// The program it contains is loaded into memory and everything is set
+    /// up so that user instructions can start to be executed.
     ///
     /// Parameters:
-    /// * `executable_file` is the open file that corresponds to the
-    ///   program; it contains the object code to load into memory.
-    AddressSpace(OpenFile *executable_file, int _pid);
+    /// * `executable` is the program to load into memory, usually taken
+    ///   from `executableCache`.  The address space takes over the
+    ///   caller's reference to it.
+    AddressSpace(Executable *executable, int _pid);
 
     /// De-allocate an address space.
     ~AddressSpace();
@@ -50,9 +58,46 @@ public:
     void LoadPage(int addr);
     #endif
     TranslationEntry GetPageTable(int addr);
+
+    /// Check whether virtual page `vpn` belongs to the address space, that
+    /// is, it is neither past its end nor in a hole left by `UnmapFile`.
+    bool HasPage(unsigned vpn);
+
+    /// Bring every page of `[addr, addr + size)` into memory and keep it
+    /// there until `UnpinRange` is called with the same range, so that the
+    /// kernel can access it without faulting.
+    ///
+    /// Returns false, pinning nothing, if the range does not belong to the
+    /// address space.
+    bool PinRange(unsigned addr, unsigned size);
+    void UnpinRange(unsigned addr, unsigned size);
+
+    /// Return the physical address of the pinned virtual address `addr`,
+    /// marking its page as used, and as dirty if `writing`, both in the
+    /// page table and in the TLB.
+    unsigned PinnedToPhysical(unsigned addr, bool writing);
     #ifdef SWAP
     void Swap(int physical, int vpn);
     #endif
+    #ifdef DEMAND_LOADING
+    /// Map `size` bytes of `file`, starting at `offset`, right after the
+    /// current end of the address space.  Pages are brought in from the
+    /// file on demand and modified pages are written back to it when they
+    /// are evicted or unmapped.
+    ///
+    /// `offset` must be a multiple of `PAGE_SIZE`, and the mapped bytes must
+    /// lie within the file and be at most `MAX_MAPPED_SIZE`.  The mapping
+    /// holds a reference to `descriptor`, which must be a regular file, so
+    /// the file stays open until it is unmapped.  Virtual pages left free by
+    /// earlier unmappings are reused before the address space grows.
+    ///
+    /// Returns the virtual address of the mapping, or -1 on error.
+    int MapFile(FileDescriptor *descriptor, unsigned offset, unsigned size);
+
+    /// Remove the mapping starting at virtual address `addr`, writing back
+    /// every modified page.
+    bool UnmapFile(unsigned addr);
+    #endif
 
 private:
     int pid;
@@ -67,10 +112,47 @@ private:
 
     Executable* exe;
 
-    OpenFile *executableFile;
+    #ifdef DEMAND_LOADING
+    /// A region of a file mapped into the address space.
+    struct MappedFile {
+        FileDescriptor *descriptor;
+        OpenFile *file;
+        unsigned offset;     ///< Offset in the file of the first page.
+        unsigned size;       ///< Number of mapped bytes.
+        unsigned firstPage;  ///< First virtual page of the region.
+        unsigned numPages;
+    };
+
+    /// Mapped regions; entries with a null `file` are free.
+    MappedFile mappedFiles[MAX_MAPPED_FILES];
+
+    /// First virtual page past the program and its stack, where mappings
+    /// start.
+    unsigned mapBase;
+
+    /// Number of entries allocated in `pageTable`; at least `numPages`.
+    unsigned tableSize;
+
+    /// Return the first virtual page of a free run of `count` pages at or
+    /// after `mapBase`, possibly past the end of the address space.
+    unsigned FindMappingSpace(unsigned count);
+
+    /// Return the region containing virtual page `vpn`, or null if the page
+    /// does not belong to a mapped file.
+    MappedFile *FindMapping(unsigned vpn);
+
+    /// Write virtual page `vpn`, held in frame `physical`, back to its file.
+    void WriteBackMappedPage(MappedFile *m, unsigned vpn, unsigned physical);
+
+    /// Load virtual page `vpn` from its file into frame `physical`.
+    void LoadMappedPage(MappedFile *m, unsigned vpn, unsigned physical);
+    #endif
 
     #ifdef SWAP
     Bitmap *swapMap;
+    /// Pages that were all zeroes when evicted; they are zero-filled on
+    /// the next fault instead of being read back.
+    Bitmap *zeroMap;
     OpenFile *diskSpace;
     int PickVictim();
     int head;
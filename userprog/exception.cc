@@ -28,7 +28,18 @@
 #include "userprog/address_space.hh"
 #include "filesys/open_file.hh"
 #include "userprog/args.hh"
+#include "userprog/file_descriptor.hh"
+#include "userprog/pipe_buffer.hh"
+#include "userprog/poll_queue.hh"
+#include "threads/semaphore.hh"
+#include "machine/endianness.hh"
+#ifdef FILESYS
+#include "filesys/synch_disk.hh"
+#endif
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 static void
 IncrementPC()
 {
@@ -78,6 +89,574 @@ void initializeThread(void * argAddr)
 }
 
 
+/// Size of the kernel buffer through which `Read` and `Write` move data.
+///
+/// Transfers of any size are done in chunks of at most this many bytes, so
+/// the buffer can live on the kernel stack of the calling thread.
+static const unsigned IO_CHUNK_SIZE = 4 * PAGE_SIZE;
+
+/// A buffer in user memory taking part in a transfer.
+struct UserBuffer {
+    int addr;
+    int length;
+};
+
+/// Return the total length of the `count` buffers of `vec`, or -1 if one of
+/// them has a negative length or the total does not fit in an `int`, like
+/// `readv(2)` failing with `EINVAL`.
+static int
+IoVecLength(const UserBuffer *vec, unsigned count)
+{
+    int total = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (vec[i].length < 0 || vec[i].length > INT_MAX - total)
+        {
+            DEBUG('e', "Error: invalid size %d.\n", vec[i].length);
+            return -1;
+        }
+        total += vec[i].length;
+    }
+    return total;
+}
+
+/// Look up the file with user id `id` for reading or writing.
+///
+/// Returns null if `id` is not open for the requested direction.
+static FileDescriptor *
+GetIoFile(OpenFileId id, bool writing)
+{
+    if (id < 0)
+    {
+        DEBUG('e', "Error: invalid file id %d.\n", id);
+        return nullptr;
+    }
+    FileDescriptor *file = currentThread->GetFile(id);
+    if (file == nullptr)
+    {
+        DEBUG('e', "Error: file with id %d not found.\n", id);
+        return nullptr;
+    }
+    if (writing ? !file->CanWrite() : !file->CanRead())
+    {
+        DEBUG('e', "Error: file with id %d cannot be %s.\n",
+              id, writing ? "written" : "read");
+        return nullptr;
+    }
+    return file;
+}
+
+/// Read from the file with user id `id`, scattering the data over the
+/// `count` user buffers of `vec` in order.
+///
+/// Returns the number of bytes read, or -1 on error.
+static int
+DoReadV(OpenFileId id, const UserBuffer *vec, unsigned count)
+{
+    FileDescriptor *file = GetIoFile(id, false);
+    if (file == nullptr)
+        return -1;
+
+    int total = IoVecLength(vec, count);
+    if (total < 0)
+        return -1;
+
+    char buffer[IO_CHUNK_SIZE];
+    int bytesRead = 0;
+    unsigned current = 0;  // Buffer being filled, and how much of it.
+    int filled = 0;
+    while (bytesRead < total)
+    {
+        int chunk = total - bytesRead;
+        if (chunk > (int) IO_CHUNK_SIZE)
+            chunk = IO_CHUNK_SIZE;
+
+        int got = file->Read(buffer, chunk);
+        if (got < 0)
+            return bytesRead > 0 ? bytesRead : got;  // Would block.
+        for (int done = 0; done < got;)
+        {
+            if (filled == vec[current].length)
+            {
+                current++;
+                filled = 0;
+                continue;
+            }
+            int n = vec[current].length - filled;
+            if (n > got - done)
+                n = got - done;
+            WriteBufferToUser(buffer + done, vec[current].addr + filled, n);
+            filled += n;
+            done += n;
+        }
+        bytesRead += got;
+        if (got < chunk)
+            break;  // End of file, or a pipe with no more data for now.
+    }
+    DEBUG('e', "Read %d bytes from file with id `%d`.\n", bytesRead, id);
+    return bytesRead;
+}
+
+/// Write the `count` user buffers of `vec` to the file with user id `id`.
+///
+/// The buffers are gathered in the kernel, so small pieces end up in a
+/// single write to the file or the console.
+///
+/// Returns the number of bytes written, or -1 on error.
+static int
+DoWriteV(OpenFileId id, const UserBuffer *vec, unsigned count)
+{
+    FileDescriptor *file = GetIoFile(id, true);
+    if (file == nullptr || IoVecLength(vec, count) < 0)
+        return -1;
+
+    char buffer[IO_CHUNK_SIZE];
+    int used = 0;
+    int bytesWritten = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        for (int done = 0; done < vec[i].length;)
+        {
+            int n = vec[i].length - done;
+            if (n > (int) IO_CHUNK_SIZE - used)
+                n = IO_CHUNK_SIZE - used;
+            ReadBufferFromUser(vec[i].addr + done, buffer + used, n);
+            used += n;
+            done += n;
+
+            if (used == (int) IO_CHUNK_SIZE)
+            {
+                int written = file->Write(buffer, used);
+                if (written < 0)  // No reader, or it would block.
+                    return bytesWritten > 0 ? bytesWritten : written;
+                bytesWritten += written;
+                if (written < used)
+                    return bytesWritten;  // The file could not grow.
+                used = 0;
+            }
+        }
+    }
+    if (used > 0)
+    {
+        int written = file->Write(buffer, used);
+        if (written < 0)  // No reader, or it would block.
+            return bytesWritten > 0 ? bytesWritten : written;
+        bytesWritten += written;
+    }
+    DEBUG('e', "Wrote %d bytes to file with id %d.\n", bytesWritten, id);
+    return bytesWritten;
+}
+
+/// Open the file whose name is at user address `filenameAddr`.
+///
+/// Returns the new user file id, or -1 on error.
+static int
+DoOpen(int filenameAddr)
+{
+    if (filenameAddr == 0)
+    {
+        DEBUG('e', "Error: address to filename string is null.\n");
+        return -1;
+    }
+
+    char filename[PATH_NAME_MAX_LEN + 1];
+    if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
+    {
+        DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", PATH_NAME_MAX_LEN);
+        return -1;
+    }
+
+    DEBUG('e', "`Open` requested for file `%s`.\n", filename);
+    OpenFile *file = fileSystem->Open(filename);
+    if (file == nullptr)
+    {
+        DEBUG('e', "Error: could not open file `%s`.\n", filename);
+        return -1;
+    }
+
+    FileDescriptor *descriptor = new FileDescriptor(file, filename);
+    OpenFileId id = currentThread->AddFile(descriptor);
+    if (id == -1)
+    {
+        DEBUG('e', "Error: too many open files.\n");
+        descriptor->Release();
+        return -1;
+    }
+    DEBUG('e', "Opened file `%s` with id %u.\n", filename, id);
+    return id;
+}
+
+/// Close the file with user id `fid`.
+///
+/// Returns 0, or -1 on error.
+static int
+DoClose(OpenFileId fid)
+{
+    if (!currentThread->RemoveFile(fid))
+    {
+        DEBUG('e', "Error: file with id %d not found.\n", fid);
+        return -1;
+    }
+    DEBUG('e', "Closed file with id %d.\n", fid);
+    return 0;
+}
+
+/// Copy a path from user address `pathAddr` into `path`, which must hold
+/// `PATH_NAME_MAX_LEN + 1` bytes.
+static bool
+ReadPathFromUser(int pathAddr, char *path)
+{
+    if (pathAddr == 0)
+    {
+        DEBUG('e', "Error: address to path string is null.\n");
+        return false;
+    }
+    if (!ReadStringFromUser(pathAddr, path, PATH_NAME_MAX_LEN + 1))
+    {
+        DEBUG('e', "Error: path string too long (maximum is %u bytes).\n", PATH_NAME_MAX_LEN);
+        return false;
+    }
+    return true;
+}
+
+/// Create the directory named by the path at `pathAddr`.
+///
+/// Returns 0, or -1 on error.
+static int
+DoMkdir(int pathAddr)
+{
+    char path[PATH_NAME_MAX_LEN + 1];
+    if (!ReadPathFromUser(pathAddr, path))
+    {
+        return -1;
+    }
+    DEBUG('e', "`Mkdir` requested for `%s`.\n", path);
+    if (!fileSystem->Mkdir(path))
+    {
+        DEBUG('e', "Error: could not create directory `%s`.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/// Remove the empty directory named by the path at `pathAddr`.
+///
+/// Returns 0, or -1 on error.
+static int
+DoRmdir(int pathAddr)
+{
+    char path[PATH_NAME_MAX_LEN + 1];
+    if (!ReadPathFromUser(pathAddr, path))
+    {
+        return -1;
+    }
+    DEBUG('e', "`Rmdir` requested for `%s`.\n", path);
+    if (!fileSystem->Rmdir(path))
+    {
+        DEBUG('e', "Error: could not remove directory `%s`.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/// Copy the listing of the directory named at `pathAddr` into the user
+/// buffer at `bufferAddr`.  At most `IO_CHUNK_SIZE` bytes are copied.
+///
+/// Returns the number of bytes copied, or -1 on error.
+static int
+DoListDir(int pathAddr, int bufferAddr, int size)
+{
+    char path[PATH_NAME_MAX_LEN + 1];
+    if (!ReadPathFromUser(pathAddr, path))
+    {
+        return -1;
+    }
+    if (size <= 0)
+    {
+        DEBUG('e', "Error: invalid size %d.\n", size);
+        return -1;
+    }
+    DEBUG('e', "`ListDir` requested for `%s`.\n", path);
+
+    // Start with a small kernel buffer, and only grow it, up to `size`, if
+    // the directory really needs it.
+    unsigned length = (unsigned) size < IO_CHUNK_SIZE ? size : IO_CHUNK_SIZE;
+    char *buffer = new char [length]();
+    int result = fileSystem->ListDir(path, buffer, length);
+    while (result > (int) length && result <= size)
+    {
+        delete [] buffer;
+        length = result;
+        buffer = new char [length]();
+        result = fileSystem->ListDir(path, buffer, length);
+    }
+    if (result == -1)
+    {
+        DEBUG('e', "Error: `%s` is not a directory.\n", path);
+    }
+    else
+    {
+        // The buffer starts zeroed and names hold no null characters, so
+        // this is what was copied, even if the listing was cut short.
+        unsigned copied = strnlen(buffer, length);
+        if (copied > 0)
+        {
+            WriteBufferToUser(buffer, bufferAddr, copied);
+        }
+    }
+    delete [] buffer;
+    return result;
+}
+
+/// Copy an array of `count` `IoVec` from user address `vecAddr`.
+static bool
+ReadIoVecFromUser(int vecAddr, int count, UserBuffer *vec)
+{
+    if (vecAddr == 0 || count <= 0 || count > IOV_MAX)
+    {
+        DEBUG('e', "Error: invalid buffer vector of %d entries.\n", count);
+        return false;
+    }
+    int raw[2 * IOV_MAX];
+    ReadBufferFromUser(vecAddr, (char *) raw, count * 2 * sizeof *raw);
+    for (int i = 0; i < count; i++)
+    {
+        vec[i].addr = WordToHost(raw[2 * i]);
+        vec[i].length = WordToHost(raw[2 * i + 1]);
+    }
+    return true;
+}
+
+/// Read a word from user memory, in host byte order.
+static int
+ReadUserWord(int userAddress)
+{
+    int word;
+    ReadBufferFromUser(userAddress, (char *) &word, sizeof word);
+    return WordToHost(word);
+}
+
+/// Write a word to user memory, in machine byte order.
+static void
+WriteUserWord(int userAddress, int value)
+{
+    int word = WordToMachine(value);
+    WriteBufferToUser((const char *) &word, userAddress, sizeof word);
+}
+
+/// Run every request queued in the submission ring at user address
+/// `ringAddr`, posting one completion for each.
+///
+/// Only the queue indexes and the slots in use are pinned, each while it
+/// is accessed, so a large ring does not tie up frames that requests may
+/// need.  Processing stops early when the completion queue is full.
+///
+/// Returns the number of requests processed, or -1 on error.
+static int
+DoEnter(int ringAddr)
+{
+    if (ringAddr == 0 || ringAddr % 4 != 0)
+    {
+        DEBUG('e', "Error: invalid ring address %d.\n", ringAddr);
+        return -1;
+    }
+
+    // Ring fields are words in user memory; see `Ring` in `syscall.h`.
+    AddressSpace *space = currentThread->space;
+    const unsigned indexesSize = offsetof(Ring, sq);
+    if (!space->PinRange(ringAddr, indexesSize))
+    {
+        DEBUG('e', "Error: ring at %d is outside the address space.\n", ringAddr);
+        return -1;
+    }
+    const int sqHeadAddr = ringAddr + offsetof(Ring, sqHead);
+    const int sqTailAddr = ringAddr + offsetof(Ring, sqTail);
+    const int cqHeadAddr = ringAddr + offsetof(Ring, cqHead);
+    const int cqTailAddr = ringAddr + offsetof(Ring, cqTail);
+    unsigned sqHead = ReadUserWord(sqHeadAddr);
+    unsigned sqTail = ReadUserWord(sqTailAddr);
+    unsigned cqHead = ReadUserWord(cqHeadAddr);
+    unsigned cqTail = ReadUserWord(cqTailAddr);
+    space->UnpinRange(ringAddr, indexesSize);
+
+    // Every request takes a completion slot, so at most `RING_ENTRIES`
+    // requests are run per call.
+    int processed = 0;
+    bool failed = false;
+    while (sqHead != sqTail && cqTail - cqHead < RING_ENTRIES)
+    {
+        int sqeAddr = ringAddr + offsetof(Ring, sq)
+                      + (sqHead % RING_ENTRIES) * sizeof (RingSqe);
+        int cqeAddr = ringAddr + offsetof(Ring, cq)
+                      + (cqTail % RING_ENTRIES) * sizeof (RingCqe);
+        if (!space->PinRange(sqeAddr, sizeof (RingSqe)))
+        {
+            DEBUG('e', "Error: ring at %d is outside the address space.\n", ringAddr);
+            failed = true;
+            break;
+        }
+        int opcode   = ReadUserWord(sqeAddr + offsetof(RingSqe, opcode));
+        int id       = ReadUserWord(sqeAddr + offsetof(RingSqe, id));
+        int buffer   = ReadUserWord(sqeAddr + offsetof(RingSqe, buffer));
+        int length   = ReadUserWord(sqeAddr + offsetof(RingSqe, length));
+        int userData = ReadUserWord(sqeAddr + offsetof(RingSqe, userData));
+        space->UnpinRange(sqeAddr, sizeof (RingSqe));
+
+        // The completion slot stays pinned while the request runs, so that
+        // it can always be posted.
+        if (!space->PinRange(cqeAddr, sizeof (RingCqe)))
+        {
+            DEBUG('e', "Error: ring at %d is outside the address space.\n", ringAddr);
+            failed = true;
+            break;
+        }
+
+        int result;
+        UserBuffer vec = { buffer, length };
+        switch (opcode)
+        {
+        case RING_OP_READ:
+            result = DoReadV(id, &vec, 1);
+            break;
+        case RING_OP_WRITE:
+            result = length > 0 ? DoWriteV(id, &vec, 1) : -1;
+            break;
+        case RING_OP_OPEN:
+            result = DoOpen(buffer);
+            break;
+        case RING_OP_CLOSE:
+            result = DoClose(id);
+            break;
+        default:
+            DEBUG('e', "Error: unknown ring operation %d.\n", opcode);
+            result = -1;
+        }
+
+        WriteUserWord(cqeAddr + offsetof(RingCqe, userData), userData);
+        WriteUserWord(cqeAddr + offsetof(RingCqe, result), result);
+        space->UnpinRange(cqeAddr, sizeof (RingCqe));
+        sqHead++;
+        cqTail++;
+        processed++;
+    }
+
+    WriteUserWord(sqHeadAddr, sqHead);
+    WriteUserWord(cqTailAddr, cqTail);
+    DEBUG('e', "Processed %d ring requests.\n", processed);
+    return failed && processed == 0 ? -1 : processed;
+}
+
+/// A pending `Poll` timeout.
+///
+/// The interrupt cannot be cancelled, so the record belongs to its handler:
+/// a poller that is done before the timeout clears `waiter`, and the
+/// handler frees the record when it finally runs.
+struct PollTimer {
+    Semaphore *waiter;  ///< Null once the poller no longer waits.
+    bool expired;
+};
+
+static void
+PollTimeout(void *arg)
+{
+    PollTimer *pollTimer = (PollTimer *) arg;
+    if (pollTimer->waiter == nullptr)
+    {
+        delete pollTimer;
+        return;
+    }
+    pollTimer->expired = true;
+    pollTimer->waiter->V();
+}
+
+/// Wait for any of the `count` files described by the `PollFd` array at
+/// user address `fdsAddr` to become ready, for at most `timeout` ticks.
+///
+/// The calling thread sleeps on a semaphore queued on every pipe and on the
+/// console; it is woken whenever one of them changes, and then checks the
+/// files again.
+///
+/// Returns the number of ready files, 0 on timeout, or -1 on error.
+static int
+DoPoll(int fdsAddr, int count, int timeout)
+{
+    if (fdsAddr == 0 || count <= 0 || count > POLL_MAX)
+    {
+        DEBUG('e', "Error: invalid poll set of %d entries.\n", count);
+        return -1;
+    }
+    int raw[3 * POLL_MAX];
+    ReadBufferFromUser(fdsAddr, (char *) raw, count * 3 * sizeof *raw);
+
+    FileDescriptor *files[POLL_MAX];
+    int events[POLL_MAX];
+    for (int i = 0; i < count; i++)
+    {
+        OpenFileId id = WordToHost(raw[3 * i]);
+        files[i] = id < 0 ? nullptr : currentThread->GetFile(id);
+        if (files[i] == nullptr)
+        {
+            DEBUG('e', "Error: file with id %d not found.\n", id);
+            for (int j = 0; j < i; j++)
+                files[j]->Release();
+            return -1;
+        }
+        files[i]->Retain();  // Other threads may close the id meanwhile.
+        events[i] = WordToHost(raw[3 * i + 1]) & (POLL_IN | POLL_OUT);
+    }
+
+    Semaphore waiter("poll", 0);
+    for (int i = 0; i < count; i++)
+    {
+        PollQueue *queue = files[i]->GetPollQueue();
+        if (queue != nullptr)
+            queue->Add(&waiter);
+    }
+
+    PollTimer *pollTimer = nullptr;
+    int ready;
+    for (;;)
+    {
+        ready = 0;
+        for (int i = 0; i < count; i++)
+        {
+            int revents = files[i]->PollEvents() & (events[i] | POLL_HUP);
+            raw[3 * i + 2] = WordToMachine(revents);
+            if (revents != 0)
+                ready++;
+        }
+        if (ready > 0 || timeout == 0
+              || (pollTimer != nullptr && pollTimer->expired))
+            break;
+        if (timeout > 0 && pollTimer == nullptr)
+        {
+            pollTimer = new PollTimer {&waiter, false};
+            interrupt->Schedule(PollTimeout, pollTimer, timeout, TIMER_INT);
+        }
+        waiter.P();
+    }
+
+    if (pollTimer != nullptr)
+    {
+        if (pollTimer->expired)
+            delete pollTimer;
+        else
+            pollTimer->waiter = nullptr;  // The handler frees it.
+    }
+    for (int i = 0; i < count; i++)
+    {
+        PollQueue *queue = files[i]->GetPollQueue();
+        if (queue != nullptr)
+            queue->Remove(&waiter);
+        files[i]->Release();
+    }
+
+    WriteBufferToUser((const char *) raw, fdsAddr,
+                      count * 3 * sizeof *raw);
+    DEBUG('e', "Poll returned %d ready files.\n", ready);
+    return ready;
+}
+
 /// Handle a system call exception.
 ///
 /// * `et` is the kind of exception.  The list of possible exceptions is in
@@ -98,6 +677,7 @@ static void
 SyscallHandler(ExceptionType _et)
 {
     int scid = machine->ReadRegister(2);
+    stats->numSyscalls++;
 
     switch (scid)
     {
@@ -106,12 +686,28 @@ SyscallHandler(ExceptionType _et)
     {
         int status = machine->ReadRegister(4);
         DEBUG('e', "Shutdown, initiated by user program with status %d.\n", status);
-        currentThread->Finish();
+        // Close files now, while blocking is allowed, so that readers of
+        // pipes this program was writing see the end of the data.
+        currentThread->CloseFiles();
+        // Give back frames and swap right away too; only the exit status
+        // is kept until the program is joined.
+        delete currentThread->space;
+        currentThread->space = nullptr;
+        // Nobody is left to join the children that are not joined yet.
+        currentThread->DetachChildren();
+        currentThread->Finish(status);
         break;
     }
 
     case SC_HALT:
         DEBUG('e', "Shutdown, initiated by user program.\n");
+        // Close the files of the program while blocking is allowed; the
+        // headers of files other programs still hold are written back.
+        currentThread->CloseFiles();
+#ifdef FILESYS
+        fileNodeTable->Flush();
+        synchDisk->Flush();
+#endif
         interrupt->Halt();
         break;
 
@@ -125,15 +721,16 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
-        char filename[FILE_NAME_MAX_LEN + 1];
+        char filename[PATH_NAME_MAX_LEN + 1];
         if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
         {
-            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", FILE_NAME_MAX_LEN);
+            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", PATH_NAME_MAX_LEN);
             machine->WriteRegister(2, -1);
             break;
         }
 
         DEBUG('e', "`Create` requested for file `%s`.\n", filename);
+        executableCache->Invalidate(filename);
         if (!fileSystem->Create(filename, 0))
         {
             DEBUG('e', "Error: could not create file `%s`.\n", filename);
@@ -150,53 +747,14 @@ SyscallHandler(ExceptionType _et)
     {
         int fid = machine->ReadRegister(4);
         DEBUG('e', "`Close` requested for id %u.\n", fid);
-        if (fid < 2)
-        {
-            DEBUG('e', "Error: cannot close file with id %d.\n", fid);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-        if (!currentThread->RemoveFile(fid))
-        {
-            DEBUG('e', "Error: file with id %d not found.\n", fid);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-        DEBUG('e', "Closed file with id %d.\n", fid);
-        machine->WriteRegister(2, 0);
+        machine->WriteRegister(2, DoClose(fid));
         break;
     }
 
     case SC_OPEN:
     {
         int filenameAddr = machine->ReadRegister(4);
-        if (filenameAddr == 0)
-        {
-            DEBUG('e', "Error: address to filename string is null.\n");
-            machine->WriteRegister(2, -1);
-            break;
-        }
-
-        char filename[FILE_NAME_MAX_LEN + 1];
-        if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
-        {
-            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", FILE_NAME_MAX_LEN);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-
-        DEBUG('e', "`Open` requested for file `%s`.\n", filename);
-        OpenFile *file = fileSystem->Open(filename);
-        if (file == nullptr)
-        {
-            DEBUG('e', "Error: could not open file `%s`.\n", filename);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-
-        OpenFileId id = currentThread->AddFile(file);
-        DEBUG('e', "Opened file `%s` with id %u.\n", filename, id + 2);
-        machine->WriteRegister(2, id + 2);
+        machine->WriteRegister(2, DoOpen(filenameAddr));
         break;
     }
 
@@ -205,56 +763,10 @@ SyscallHandler(ExceptionType _et)
         int buffAddr = machine->ReadRegister(4);
         int size = machine->ReadRegister(5);
         OpenFileId id = machine->ReadRegister(6);
-        int bytesRead = 0;
 
         DEBUG('e',"`Read` requested for file with id `%d`.\n", id);
-        if (id < 0)
-        {
-            DEBUG('e', "Error: invalid file id %d.\n", id);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-        if (size < 0)
-        {
-            DEBUG('e', "Error: invalid size %d.\n", size);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-        char bufferSys[size + 1];
-        if (id == 0)
-        {
-            synchConsole->ReadBuffer(bufferSys, size);
-            bufferSys[size] = '\0';
-            bytesRead = size;
-            if (bytesRead != 0)
-                WriteBufferToUser(bufferSys, buffAddr, bytesRead);
-            DEBUG('e', "Read from stdin: %s, %d bytes\n", bufferSys, size);
-            machine->WriteRegister(2, size);
-            break;
-        }
-        if (id == 1)
-        {
-            DEBUG('e', "Error: tried to read from stdout\n");
-            machine->WriteRegister(2, -1);
-            break;
-        }
-        OpenFile *file = currentThread->GetFile(id - 2);
-        if (file == nullptr)
-        {
-            DEBUG('e', "Error: file with id %d not found.\n", id);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-
-        bytesRead = file->Read(bufferSys, size);
-        DEBUG('e', "Read %d bytes from file with id `%d`.\n", bytesRead, id);
-        bufferSys[bytesRead] = '\0';
-        if (bytesRead != 0)
-            WriteBufferToUser(bufferSys, buffAddr, bytesRead);
-        
-        DEBUG('e',"Read file with id `%d`.\n", id);
-        machine->WriteRegister(2, bytesRead);
-
+        UserBuffer vec = { buffAddr, size };
+        machine->WriteRegister(2, DoReadV(id, &vec, 1));
         break;
     }
 
@@ -265,49 +777,48 @@ SyscallHandler(ExceptionType _et)
         OpenFileId id = machine->ReadRegister(6);
 
         DEBUG('e', "`Write` requested for file with id %d.\n", id);
-
-        if (id < 0)
-        {
-            DEBUG('e', "Error: invalid file id %d.\n", id);
-            machine->WriteRegister(2, -1);
-            break;
-        }
-
         if (size <= 0)
         {
             DEBUG('e', "Error: invalid size %d.\n", size);
             machine->WriteRegister(2, -1);
             break;
         }
-    
-        if (id == 0)
+        UserBuffer vec = { buffAddr, size };
+        machine->WriteRegister(2, DoWriteV(id, &vec, 1));
+        break;
+    }
+
+    case SC_READV:
+    {
+        int vecAddr = machine->ReadRegister(4);
+        int count = machine->ReadRegister(5);
+        OpenFileId id = machine->ReadRegister(6);
+
+        DEBUG('e', "`ReadV` requested for file with id %d.\n", id);
+        UserBuffer vec[IOV_MAX];
+        if (!ReadIoVecFromUser(vecAddr, count, vec))
         {
-            DEBUG('e', "Error: tried to write in stdin\n");
             machine->WriteRegister(2, -1);
             break;
         }
-        char buffSys[size + 1];
-        ReadBufferFromUser(buffAddr, buffSys, size);
-        if (id == 1)
-        {
-            DEBUG('e', "Wrote to stdout: %s, %d bytes\n", buffSys, size);
-            buffSys[size] = '\0';
-            synchConsole->WriteBuffer(buffSys, size);
-            machine->WriteRegister(2, size);
-            break;
-        }
+        machine->WriteRegister(2, DoReadV(id, vec, count));
+        break;
+    }
 
-        OpenFile *file = currentThread->GetFile(id - 2);
-        if (file == nullptr)
+    case SC_WRITEV:
+    {
+        int vecAddr = machine->ReadRegister(4);
+        int count = machine->ReadRegister(5);
+        OpenFileId id = machine->ReadRegister(6);
+
+        DEBUG('e', "`WriteV` requested for file with id %d.\n", id);
+        UserBuffer vec[IOV_MAX];
+        if (!ReadIoVecFromUser(vecAddr, count, vec))
         {
-            DEBUG('e', "Error: file with id %d not found.\n", id);
             machine->WriteRegister(2, -1);
             break;
         }
-        
-        int bytesWritten = file->Write(buffSys, size);
-        DEBUG('e', "Wrote file with id %d.\n", id);
-        machine->WriteRegister(2, bytesWritten);
+        machine->WriteRegister(2, DoWriteV(id, vec, count));
         break;
     }
 
@@ -321,16 +832,17 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
-        char filename[FILE_NAME_MAX_LEN + 1];
+        char filename[PATH_NAME_MAX_LEN + 1];
         if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
         {
-            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", FILE_NAME_MAX_LEN);
+            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", PATH_NAME_MAX_LEN);
             machine->WriteRegister(2, -1);
             break;
         }
 
         DEBUG('e', "`Remove` requested for file `%s`.\n", filename);
 
+        executableCache->Invalidate(filename);
         if (fileSystem->Remove(filename)){
             DEBUG('e', "Removed file `%s`.\n", filename);
             machine->WriteRegister(2, 0);
@@ -362,8 +874,15 @@ SyscallHandler(ExceptionType _et)
             machine->WriteRegister(2, -1);
             break;
         }
-        thread->Join();
-        machine->WriteRegister(2, 0);
+        if (!thread->IsJoinable() || thread->HasJoiner())
+        {
+            DEBUG('e', "Error: thread %d cannot be joined.\n", tid);
+            machine->WriteRegister(2, -1);
+            break;
+        }
+        int status = thread->Join();
+        DEBUG('e', "Joined thread %d, exit status %d.\n", tid, status);
+        machine->WriteRegister(2, status);
         break;
     }
     case SC_EXEC:
@@ -378,26 +897,26 @@ SyscallHandler(ExceptionType _et)
             break;
         }
 
-        char filename[FILE_NAME_MAX_LEN + 1];
+        char filename[PATH_NAME_MAX_LEN + 1];
         if (!ReadStringFromUser(filenameAddr, filename, sizeof filename))
         {
-            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", FILE_NAME_MAX_LEN);
+            DEBUG('e', "Error: filename string too long (maximum is %u bytes).\n", PATH_NAME_MAX_LEN);
             machine->WriteRegister(2, -1);
             break;
         }
 
         DEBUG('e', "`Exec` requested for file `%s`.\n", filename);
-        OpenFile *executable = fileSystem->Open(filename);
-        if (executable == nullptr)
+        if(addrPointer == nullptr)
         {
-            DEBUG('e', "Error: could not open file `%s`.\n", filename);
+            DEBUG('e', "Error: error reading arguments.\n");
             machine->WriteRegister(2, -1);
             break;
         }
 
-        if(addrPointer == nullptr)
+        Executable *executable = executableCache->Get(filename);
+        if (executable == nullptr)
         {
-            DEBUG('e', "Error: error reading arguments.\n");
+            DEBUG('e', "Error: could not load file `%s`.\n", filename);
             machine->WriteRegister(2, -1);
             break;
         }
@@ -410,12 +929,198 @@ SyscallHandler(ExceptionType _et)
         ASSERT(space != nullptr);
 
         thread->space = space;
-        
+        thread->InheritFiles(currentThread);
+        thread->SetParent(currentThread);
+
         thread->Fork(initializeThread, (void*) (addrPointer));
         
         machine->WriteRegister(2, thread->GetId());
         break;
     }
+    case SC_MMAP:
+    {
+        OpenFileId id = machine->ReadRegister(4);
+
+        DEBUG('e', "`Mmap` requested for file with id %d.\n", id);
+        FileDescriptor *file = id < 0 ? nullptr : currentThread->GetFile(id);
+        if (file == nullptr || file->GetFile() == nullptr)
+        {
+            DEBUG('e', "Error: id %d is not an open file.\n", id);
+            machine->WriteRegister(2, -1);
+            break;
+        }
+#ifdef DEMAND_LOADING
+        unsigned offset = machine->ReadRegister(5);
+        unsigned size = machine->ReadRegister(6);
+        int addr = currentThread->space->MapFile(file, offset, size);
+        if (addr == -1)
+        {
+            DEBUG('e', "Error: could not map %u bytes at offset %u.\n", size, offset);
+        }
+        else
+        {
+            DEBUG('e', "Mapped file with id %d at address %d.\n", id, addr);
+        }
+        machine->WriteRegister(2, addr);
+#else
+        DEBUG('e', "Error: `Mmap` requires demand loading.\n");
+        machine->WriteRegister(2, -1);
+#endif
+        break;
+    }
+
+    case SC_MUNMAP:
+    {
+        int addr = machine->ReadRegister(4);
+
+        DEBUG('e', "`Munmap` requested for address %d.\n", addr);
+#ifdef DEMAND_LOADING
+        if (!currentThread->space->UnmapFile(addr))
+        {
+            DEBUG('e', "Error: no mapping starts at address %d.\n", addr);
+            machine->WriteRegister(2, -1);
+            break;
+        }
+        machine->WriteRegister(2, 0);
+#else
+        machine->WriteRegister(2, -1);
+#endif
+        break;
+    }
+
+    case SC_PIPE:
+    {
+        int idsAddr = machine->ReadRegister(4);
+        DEBUG('e', "`Pipe` requested.\n");
+        if (idsAddr == 0)
+        {
+            DEBUG('e', "Error: address to file id pair is null.\n");
+            machine->WriteRegister(2, -1);
+            break;
+        }
+
+        PipeBuffer *pipe = new PipeBuffer;
+        FileDescriptor *readEnd = new FileDescriptor(pipe, false);
+        FileDescriptor *writeEnd = new FileDescriptor(pipe, true);
+        OpenFileId readId = currentThread->AddFile(readEnd);
+        OpenFileId writeId = readId == -1 ? -1 : currentThread->AddFile(writeEnd);
+        if (writeId == -1)
+        {
+            DEBUG('e', "Error: too many open files.\n");
+            if (readId != -1)
+                currentThread->RemoveFile(readId);
+            else
+                readEnd->Release();
+            writeEnd->Release();  // The last end deletes the pipe.
+            machine->WriteRegister(2, -1);
+            break;
+        }
+        WriteUserWord(idsAddr, readId);
+        WriteUserWord(idsAddr + 4, writeId);
+        DEBUG('e', "Created pipe with ids %d and %d.\n", readId, writeId);
+        machine->WriteRegister(2, 0);
+        break;
+    }
+
+    case SC_DUP:
+    {
+        OpenFileId id = machine->ReadRegister(4);
+        DEBUG('e', "`Dup` requested for id %d.\n", id);
+        FileDescriptor *file = id < 0 ? nullptr : currentThread->GetFile(id);
+        if (file == nullptr)
+        {
+            DEBUG('e', "Error: file with id %d not found.\n", id);
+            machine->WriteRegister(2, -1);
+            break;
+        }
+        file->Retain();
+        OpenFileId newId = currentThread->AddFile(file);
+        if (newId == -1)
+        {
+            DEBUG('e', "Error: too many open files.\n");
+            file->Release();
+        }
+        machine->WriteRegister(2, newId);
+        break;
+    }
+
+    case SC_DUP2:
+    {
+        OpenFileId id = machine->ReadRegister(4);
+        OpenFileId newId = machine->ReadRegister(5);
+        DEBUG('e', "`Dup2` requested from id %d to id %d.\n", id, newId);
+        FileDescriptor *file = id < 0 ? nullptr : currentThread->GetFile(id);
+        int result = file == nullptr ? -1 : currentThread->SetFile(newId, file);
+        if (result == -1)
+        {
+            DEBUG('e', "Error: cannot copy id %d to id %d.\n", id, newId);
+        }
+        machine->WriteRegister(2, result);
+        break;
+    }
+
+    case SC_POLL:
+    {
+        int fdsAddr = machine->ReadRegister(4);
+        int count = machine->ReadRegister(5);
+        int timeout = machine->ReadRegister(6);
+        DEBUG('e', "`Poll` requested for %d files, timeout %d.\n",
+              count, timeout);
+        machine->WriteRegister(2, DoPoll(fdsAddr, count, timeout));
+        break;
+    }
+
+    case SC_SETNONBLOCKING:
+    {
+        OpenFileId id = machine->ReadRegister(4);
+        int nonBlocking = machine->ReadRegister(5);
+        DEBUG('e', "`SetNonBlocking` requested for id %d.\n", id);
+        FileDescriptor *file = id < 0 ? nullptr : currentThread->GetFile(id);
+        if (file == nullptr)
+        {
+            DEBUG('e', "Error: file with id %d not found.\n", id);
+            machine->WriteRegister(2, -1);
+            break;
+        }
+        file->SetNonBlocking(nonBlocking != 0);
+        machine->WriteRegister(2, 0);
+        break;
+    }
+
+    case SC_SYNC:
+        DEBUG('e', "`Sync` requested.\n");
+#ifdef FILESYS
+        fileNodeTable->Flush();
+        synchDisk->Flush();
+#endif
+        machine->WriteRegister(2, 0);
+        break;
+
+    case SC_MKDIR:
+        machine->WriteRegister(2, DoMkdir(machine->ReadRegister(4)));
+        break;
+
+    case SC_RMDIR:
+        machine->WriteRegister(2, DoRmdir(machine->ReadRegister(4)));
+        break;
+
+    case SC_LISTDIR:
+    {
+        int pathAddr = machine->ReadRegister(4);
+        int bufferAddr = machine->ReadRegister(5);
+        int size = machine->ReadRegister(6);
+        machine->WriteRegister(2, DoListDir(pathAddr, bufferAddr, size));
+        break;
+    }
+
+    case SC_ENTER:
+    {
+        int ringAddr = machine->ReadRegister(4);
+        DEBUG('e', "`Enter` requested for ring at %d.\n", ringAddr);
+        machine->WriteRegister(2, DoEnter(ringAddr));
+        break;
+    }
+
     default:
         fprintf(stderr, "Unexpected system call: id %d.\n", scid);
         ASSERT(false);
@@ -432,6 +1137,11 @@ static void PageFaultHandler(ExceptionType et)
     int addr = vaddr / PAGE_SIZE;
     DEBUG('e', "Page fault at address %u.\n", vaddr);
     // podriamos llegar a necesitar el puntero de el address space 
+    if (!currentThread->space->HasPage(addr)) {
+        // Past the end, or in a hole left by `Munmap`.
+        DefaultHandler(ADDRESS_ERROR_EXCEPTION);
+        return;
+    }
     #ifdef DEMAND_LOADING
         DEBUG('e', "Page %d, valid:%d.\n", addr, currentThread->space->GetPageTable(addr).valid);
         if(!currentThread->space->GetPageTable(addr).valid){
@@ -7,6 +7,8 @@
 #include "executable.hh"
 #include "machine/endianness.hh"
 
+#include <string.h>
+
 
 /// Do little endian to big endian conversion on the bytes in the object file
 /// header, in case the file was generated on a little endian machine, and we
@@ -34,6 +36,69 @@ Executable::Executable(OpenFile *new_file)
 
     file = new_file;
     file->ReadAt((char *) &header, sizeof header, 0);
+    code = nullptr;
+    initData = nullptr;
+    references = 1;
+}
+
+Executable::~Executable()
+{
+    ASSERT(references == 0);
+    delete [] code;
+    delete [] initData;
+    delete file;
+}
+
+void
+Executable::Retain()
+{
+    references++;
+}
+
+void
+Executable::Release()
+{
+    ASSERT(references > 0);
+    if (--references == 0) {
+        delete this;
+    }
+}
+
+bool
+Executable::ReadFully(char *dest, uint32_t size, uint32_t position)
+{
+    uint32_t done = 0;
+    while (done < size) {
+        int bytes = file->ReadAt(dest + done, size - done, position + done);
+        if (bytes <= 0) {
+            return false;
+        }
+        done += bytes;
+    }
+    return true;
+}
+
+bool
+Executable::Preload()
+{
+    ASSERT(file != nullptr);
+
+    if (header.code.size > 0) {
+        code = new char [header.code.size];
+        if (!ReadFully(code, header.code.size, header.code.inFileAddr)) {
+            return false;
+        }
+    }
+    if (header.initData.size > 0) {
+        initData = new char [header.initData.size];
+        if (!ReadFully(initData, header.initData.size,
+                       header.initData.inFileAddr)) {
+            return false;
+        }
+    }
+    delete file;
+    file = nullptr;
+    return true;
 }
 
 bool
@@ -88,6 +153,14 @@ Executable::ReadCodeBlock(char *dest, uint32_t size, uint32_t offset)
     ASSERT(dest != nullptr);
     ASSERT(size != 0);
     ASSERT(offset < header.code.size);
+
+    if (code != nullptr) {
+        if (size > header.code.size - offset) {
+            size = header.code.size - offset;
+        }
+        memcpy(dest, code + offset, size);
+        return size;
+    }
     return file->ReadAt(dest, size, header.code.inFileAddr + offset);
 }
 
@@ -98,5 +171,12 @@ Executable::ReadDataBlock(char *dest, uint32_t size, uint32_t offset)
     ASSERT(size != 0);
     ASSERT(offset < header.initData.size);
 
+    if (initData != nullptr) {
+        if (size > header.initData.size - offset) {
+            size = header.initData.size - offset;
+        }
+        memcpy(dest, initData + offset, size);
+        return size;
+    }
     return file->ReadAt(dest, size, header.initData.inFileAddr + offset);
 }
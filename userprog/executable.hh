@@ -21,10 +21,25 @@
 
 
 /// Assumes that the object code file is in NOFF format.
+///
+/// Executables are reference counted, so that the image of a program can
+/// be shared by every process running it (see `ExecutableCache`).  The
+/// executable takes ownership of `new_file`.
 class  Executable {
 public:
     Executable(OpenFile *new_file);
 
+    /// Add and drop references.  The executable deletes itself, closing
+    /// its file, when the last one is dropped.
+    void Retain();
+    void Release();
+
+    /// Read the code and initialized data segments into memory, so that
+    /// later block reads do not touch the file, and close the file.
+    ///
+    /// Returns false if the file is shorter than its header says.
+    bool Preload();
+
     /// Check if the executable is valid and fix endianness if necessary.
     ///
     /// Check if the executable conforms to the NOFF file format by checking
@@ -63,8 +78,18 @@ public:
     int ReadDataBlock(char *dest, uint32_t size, uint32_t offset);
 
 private:
-    OpenFile *file;
+    ~Executable();
+
+    /// Read `size` bytes at `position` of the file, retrying short reads.
+    bool ReadFully(char *dest, uint32_t size, uint32_t position);
+
+    OpenFile *file;  ///< Null once the segments are preloaded.
     noffHeader header;
+
+    char *code;      ///< Preloaded segments, or null.
+    char *initData;
+
+    unsigned references;
 };
 
 
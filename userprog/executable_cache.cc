@@ -0,0 +1,194 @@
+/// Routines to manage the executable cache.
+
+#include "executable_cache.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+#ifndef FILESYS
+/// Copy `path` into `out`, of `size` bytes, leaving out `.` components and
+/// repeated or trailing slashes.  Returns false if it does not fit.
+static bool
+NormalizePath(const char *path, char *out, unsigned size)
+{
+    unsigned n = 0;
+    for (const char *p = path; *p != '\0'; p++) {
+        bool componentStart = n == 0 || out[n - 1] == '/';
+        if (componentStart && *p == '.' && (p[1] == '/' || p[1] == '\0')) {
+            if (p[1] == '/') {
+                p++;  // Drop the slash after it as well.
+            }
+            continue;
+        }
+        if (*p == '/' && n > 0 && out[n - 1] == '/') {
+            continue;
+        }
+        if (n + 1 >= size) {
+            return false;
+        }
+        out[n++] = *p;
+    }
+    if (n > 1 && out[n - 1] == '/') {
+        n--;
+    }
+    out[n] = '\0';
+    return true;
+}
+#endif
+
+bool
+ExecutableCache::KeyOf(const char *name, Key *key)
+{
+    ASSERT(name != nullptr);
+    ASSERT(key != nullptr);
+
+#ifdef FILESYS
+    int sector = fileSystem->Find(name);
+    key->sector = sector;
+    return sector != -1;
+#else
+    return NormalizePath(name, key->path, sizeof key->path);
+#endif
+}
+
+bool
+ExecutableCache::KeyOf(const OpenFile *file, const char *name, Key *key)
+{
+    ASSERT(file != nullptr);
+    ASSERT(name != nullptr);
+    ASSERT(key != nullptr);
+
+#ifdef FILESYS
+    key->sector = file->GetSector();
+    return true;
+#else
+    return NormalizePath(name, key->path, sizeof key->path);
+#endif
+}
+
+/// Check whether `a` and `b` are the keys of the same file.
+static bool
+SameKey(const ExecutableCache::Key &a, const ExecutableCache::Key &b)
+{
+#ifdef FILESYS
+    return a.sector == b.sector;
+#else
+    return strcmp(a.path, b.path) == 0;
+#endif
+}
+
+ExecutableCache::ExecutableCache()
+{
+    for (unsigned i = 0; i < EXECUTABLE_CACHE_SIZE; i++) {
+        entries[i].exe = nullptr;
+    }
+    clock = 0;
+}
+
+ExecutableCache::~ExecutableCache()
+{
+    for (unsigned i = 0; i < EXECUTABLE_CACHE_SIZE; i++) {
+        if (entries[i].exe != nullptr) {
+            entries[i].exe->Release();
+        }
+    }
+}
+
+ExecutableCache::Entry *
+ExecutableCache::Find(const Key &key)
+{
+    for (unsigned i = 0; i < EXECUTABLE_CACHE_SIZE; i++) {
+        if (entries[i].exe != nullptr && SameKey(entries[i].key, key)) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+ExecutableCache::Entry *
+ExecutableCache::PickEntry()
+{
+    Entry *victim = &entries[0];
+    for (unsigned i = 0; i < EXECUTABLE_CACHE_SIZE; i++) {
+        if (entries[i].exe == nullptr) {
+            return &entries[i];
+        }
+        if (entries[i].lastUse < victim->lastUse) {
+            victim = &entries[i];
+        }
+    }
+    DEBUG('e', "Evicting an executable from the cache.\n");
+    victim->exe->Release();
+    victim->exe = nullptr;
+    return victim;
+}
+
+Executable *
+ExecutableCache::Get(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    Key key;
+    Entry *e = KeyOf(name, &key) ? Find(key) : nullptr;
+    if (e != nullptr) {
+        stats->execCacheHits++;
+        e->lastUse = ++clock;
+        e->exe->Retain();
+        return e->exe;
+    }
+
+    stats->execCacheMisses++;
+    OpenFile *file = fileSystem->Open(name);
+    if (file == nullptr) {
+        return nullptr;
+    }
+    // Key on the file actually opened, in case `name` changed meanwhile.
+    bool cacheable = KeyOf(file, name, &key);
+    Executable *exe = new Executable(file);
+    if (!exe->CheckMagic() || !exe->Preload()) {
+        DEBUG('e', "Error: `%s` is not a valid executable.\n", name);
+        exe->Release();
+        return nullptr;
+    }
+    if (!cacheable) {
+        return exe;
+    }
+
+    // Loading may have blocked, and another thread may have cached the same
+    // program meanwhile.
+    if ((e = Find(key)) != nullptr) {
+        exe->Release();
+        e->lastUse = ++clock;
+        e->exe->Retain();
+        return e->exe;
+    }
+    e = PickEntry();
+    e->key = key;
+    e->exe = exe;
+    e->lastUse = ++clock;
+    exe->Retain();  // The reference of the caller.
+    return exe;
+}
+
+void
+ExecutableCache::Invalidate(const char *name)
+{
+    ASSERT(name != nullptr);
+
+    Key key;
+    if (KeyOf(name, &key)) {
+        Invalidate(key);
+    }
+}
+
+void
+ExecutableCache::Invalidate(const Key &key)
+{
+    Entry *e = Find(key);
+    if (e != nullptr) {
+        DEBUG('e', "Dropping a cached executable.\n");
+        e->exe->Release();
+        e->exe = nullptr;
+    }
+}
@@ -0,0 +1,77 @@
+/// Parsed and preloaded executables, shared between `Exec` calls.
+
+#ifndef NACHOS_USERPROG_EXECUTABLECACHE__HH
+#define NACHOS_USERPROG_EXECUTABLECACHE__HH
+
+
+#include "executable.hh"
+#include "filesys/directory_entry.hh"
+
+
+/// Number of executables kept after no process runs them any more.
+const unsigned EXECUTABLE_CACHE_SIZE = 8;
+
+/// Keeps the image of recently run programs, keyed by file.
+///
+/// An image holds the NOFF header and the code and initialized data
+/// segments, so starting a program that is cached reads nothing from the
+/// file system.  The cache holds one reference to every image it keeps,
+/// and every address space holds another one, so evicting or invalidating
+/// an image never affects processes already running it.
+class ExecutableCache {
+public:
+
+    /// What tells files apart: the header sector with the Nachos file
+    /// system, where every path naming a file leads to it; with the stub,
+    /// the path with `.` components and repeated or trailing slashes
+    /// dropped.
+    struct Key {
+    #ifdef FILESYS
+        unsigned sector;
+    #else
+        char path[PATH_NAME_MAX_LEN + 1];
+    #endif
+    };
+
+    /// Compute the key of the file named `name`.  Returns false if there
+    /// is no such file, or the path is too long to be a key.
+    static bool KeyOf(const char *name, Key *key);
+
+    /// Compute the key of `file`, opened under `name`.
+    static bool KeyOf(const OpenFile *file, const char *name, Key *key);
+
+    ExecutableCache();
+    ~ExecutableCache();
+
+    /// Return the image of the program stored in file `name`, loading it
+    /// if needed.  The caller gets a reference, to be dropped with
+    /// `Executable::Release`.
+    ///
+    /// Returns null if the file cannot be opened or is not a valid NOFF
+    /// executable.
+    Executable *Get(const char *name);
+
+    /// Forget the image of a file, if any.  Must be called whenever the
+    /// file is removed, created anew or written.
+    void Invalidate(const char *name);
+    void Invalidate(const Key &key);
+
+private:
+    struct Entry {
+        Key key;
+        Executable *exe;         ///< Null if the entry is free.
+        unsigned long lastUse;
+    };
+
+    /// Return the entry for `key`, or null if it is not cached.
+    Entry *Find(const Key &key);
+
+    /// Return a free entry, evicting the least recently used if needed.
+    Entry *PickEntry();
+
+    Entry entries[EXECUTABLE_CACHE_SIZE];
+    unsigned long clock;
+};
+
+
+#endif
@@ -0,0 +1,185 @@
+/// Routines to manage file descriptors.
+
+#include "userprog/file_descriptor.hh"
+#include "userprog/syscall.h"
+#include "threads/system.hh"
+
+
+FileDescriptor::FileDescriptor(Kind consoleKind)
+{
+    ASSERT(consoleKind == CONSOLE_INPUT_KIND
+           || consoleKind == CONSOLE_OUTPUT_KIND);
+    kind = consoleKind;
+    file = nullptr;
+    hasKey = false;
+    pipe = nullptr;
+    references = 1;
+    nonBlocking = false;
+}
+
+FileDescriptor::FileDescriptor(OpenFile *openFile, const char *fileName)
+{
+    ASSERT(openFile != nullptr);
+    ASSERT(fileName != nullptr);
+    kind = FILE_KIND;
+    file = openFile;
+    hasKey = ExecutableCache::KeyOf(openFile, fileName, &key);
+    pipe = nullptr;
+    references = 1;
+    nonBlocking = false;
+}
+
+FileDescriptor::FileDescriptor(PipeBuffer *aPipe, bool writeEnd)
+{
+    ASSERT(aPipe != nullptr);
+    kind = writeEnd ? PIPE_WRITE_KIND : PIPE_READ_KIND;
+    file = nullptr;
+    hasKey = false;
+    pipe = aPipe;
+    pipe->OpenEnd(writeEnd);
+    references = 1;
+    nonBlocking = false;
+}
+
+FileDescriptor::~FileDescriptor()
+{
+    ASSERT(references == 0);
+    if (file != nullptr) {
+        NoteWrite();  // In case a program was cached halfway through.
+        delete file;
+    }
+    if (pipe != nullptr) {
+        pipe->CloseEnd(kind == PIPE_WRITE_KIND);
+        if (pipe->IsClosed()) {
+            delete pipe;
+        }
+    }
+}
+
+void
+FileDescriptor::Retain()
+{
+    references++;
+}
+
+void
+FileDescriptor::Release()
+{
+    ASSERT(references > 0);
+    if (--references == 0) {
+        delete this;
+    }
+}
+
+bool
+FileDescriptor::CanRead() const
+{
+    return kind == CONSOLE_INPUT_KIND || kind == FILE_KIND
+           || kind == PIPE_READ_KIND;
+}
+
+bool
+FileDescriptor::CanWrite() const
+{
+    return kind == CONSOLE_OUTPUT_KIND || kind == FILE_KIND
+           || kind == PIPE_WRITE_KIND;
+}
+
+int
+FileDescriptor::Read(char *buffer, int size)
+{
+    ASSERT(CanRead());
+    switch (kind) {
+        case CONSOLE_INPUT_KIND: {
+            int n = synchConsole->ReadBuffer(buffer, size, !nonBlocking);
+            return n < 0 ? E_WOULDBLOCK : n;
+        }
+        case FILE_KIND:
+            return file->Read(buffer, size);
+        default: {
+            int n = pipe->Read(buffer, size, !nonBlocking);
+            return n < 0 ? E_WOULDBLOCK : n;
+        }
+    }
+}
+
+int
+FileDescriptor::Write(char *buffer, int size)
+{
+    ASSERT(CanWrite());
+    switch (kind) {
+        case CONSOLE_OUTPUT_KIND:
+            synchConsole->WriteBuffer(buffer, size);
+            return size;
+        case FILE_KIND: {
+            int n = file->Write(buffer, size);
+            if (n > 0) {
+                NoteWrite();
+            }
+            return n;
+        }
+        default: {
+            int n = pipe->Write(buffer, size, !nonBlocking);
+            return nonBlocking && n == 0 && size > 0 ? E_WOULDBLOCK : n;
+        }
+    }
+}
+
+void
+FileDescriptor::SetNonBlocking(bool aNonBlocking)
+{
+    nonBlocking = aNonBlocking;
+}
+
+int
+FileDescriptor::PollEvents() const
+{
+    switch (kind) {
+        case CONSOLE_INPUT_KIND:
+            return synchConsole->CanReadNow() ? POLL_IN : 0;
+        case CONSOLE_OUTPUT_KIND:
+            return POLL_OUT;
+        case FILE_KIND:
+            return POLL_IN | POLL_OUT;
+        case PIPE_READ_KIND:
+            return (pipe->CanReadNow() ? POLL_IN : 0)
+                   | (pipe->HasWriters() ? 0 : POLL_HUP);
+        default:
+            return (pipe->CanWriteNow() ? POLL_OUT : 0)
+                   | (pipe->HasReaders() ? 0 : POLL_HUP);
+    }
+}
+
+PollQueue *
+FileDescriptor::GetPollQueue() const
+{
+    switch (kind) {
+        case CONSOLE_INPUT_KIND:
+            return synchConsole->GetPollQueue();
+        case PIPE_READ_KIND:
+        case PIPE_WRITE_KIND:
+            return pipe->GetPollQueue();
+        default:
+            return nullptr;
+    }
+}
+
+OpenFile *
+FileDescriptor::GetFile() const
+{
+    return file;
+}
+
+void
+FileDescriptor::NoteWrite()
+{
+    if (hasKey) {
+        executableCache->Invalidate(key);
+    }
+}
+
+FileDescriptor::Kind
+FileDescriptor::GetKind() const
+{
+    return kind;
+}
@@ -0,0 +1,93 @@
+/// Objects behind the file ids handed to user programs.
+
+#ifndef NACHOS_USERPROG_FILEDESCRIPTOR__HH
+#define NACHOS_USERPROG_FILEDESCRIPTOR__HH
+
+
+#include "filesys/open_file.hh"
+#include "userprog/executable_cache.hh"
+#include "userprog/pipe_buffer.hh"
+
+
+/// An open file, one end of a pipe, or one side of the console.
+///
+/// Descriptors are reference counted, so the same one can be installed
+/// under several ids or in several processes (on `Exec` and `Dup`).  The
+/// underlying file or pipe end is closed when the last reference goes away.
+class FileDescriptor {
+public:
+    enum Kind {
+        CONSOLE_INPUT_KIND,
+        CONSOLE_OUTPUT_KIND,
+        FILE_KIND,
+        PIPE_READ_KIND,
+        PIPE_WRITE_KIND
+    };
+
+    /// Describe one side of the console.
+    FileDescriptor(Kind consoleKind);
+
+    /// Describe the file opened under `name`; the descriptor takes
+    /// ownership of `file`.
+    ///
+    /// Writing to the file, or closing it, drops the cached image of the
+    /// executable stored in it, if any, so that `Exec` never runs stale
+    /// code.
+    FileDescriptor(OpenFile *file, const char *name);
+
+    /// Describe one end of `pipe`.  The pipe is deleted when both of its
+    /// ends are closed.
+    FileDescriptor(PipeBuffer *pipe, bool writeEnd);
+
+    /// Add and drop references.  The descriptor deletes itself when the
+    /// last one is dropped.
+    void Retain();
+    void Release();
+
+    bool CanRead() const;
+    bool CanWrite() const;
+
+    /// Read up to `size` bytes.  The console stops after a newline; a pipe
+    /// returns what is available.  In non-blocking mode, returns
+    /// `E_WOULDBLOCK` instead of waiting for data.
+    int Read(char *buffer, int size);
+
+    /// Write `size` bytes; returns the number of bytes written, or -1 if
+    /// the descriptor cannot be written.  In non-blocking mode, a full pipe
+    /// takes what fits, and `E_WOULDBLOCK` is returned if nothing did.
+    int Write(char *buffer, int size);
+
+    /// Make reads and writes fail instead of blocking.  The mode is shared
+    /// by every id referring to this descriptor.
+    void SetNonBlocking(bool nonBlocking);
+
+    /// Return the `POLL_*` events that hold right now.
+    int PollEvents() const;
+
+    /// Return the queue woken when the events may change, or null if they
+    /// never do (regular files and console output are always ready).
+    PollQueue *GetPollQueue() const;
+
+    /// Return the open file, or null if this is not a regular file.
+    OpenFile *GetFile() const;
+
+    /// Note that the file was written other than through `Write`, as when
+    /// pages of a mapping are written back.
+    void NoteWrite();
+
+    Kind GetKind() const;
+
+private:
+    ~FileDescriptor();
+
+    Kind kind;
+    OpenFile *file;
+    ExecutableCache::Key key;  ///< Identity of `file`.
+    bool hasKey;  ///< False if `file` is not a file the cache can hold.
+    PipeBuffer *pipe;
+    unsigned references;
+    bool nonBlocking;
+};
+
+
+#endif
@@ -0,0 +1,152 @@
+/// Routines to manage pipes.
+
+#include "userprog/pipe_buffer.hh"
+#include "threads/condition.hh"
+#include "threads/lock.hh"
+
+
+PipeBuffer::PipeBuffer()
+{
+    head = count = 0;
+    readers = writers = 0;
+    lock = new Lock("pipe lock");
+    notEmpty = new Condition("pipe not empty", lock);
+    notFull = new Condition("pipe not full", lock);
+}
+
+PipeBuffer::~PipeBuffer()
+{
+    ASSERT(IsClosed());
+    delete notFull;
+    delete notEmpty;
+    delete lock;
+}
+
+int
+PipeBuffer::Read(char *into, int size, bool wait)
+{
+    ASSERT(into != nullptr);
+    ASSERT(size >= 0);
+
+    lock->Acquire();
+    if (!wait && count == 0 && writers > 0) {
+        lock->Release();
+        return -1;
+    }
+    while (count == 0 && writers > 0) {
+        notEmpty->Wait();
+    }
+    int n = 0;
+    while (n < size && count > 0) {
+        into[n++] = buffer[head];
+        head = (head + 1) % PIPE_BUFFER_SIZE;
+        count--;
+    }
+    if (n > 0) {
+        notFull->Broadcast();
+        pollers.WakeAll();
+    }
+    lock->Release();
+    return n;
+}
+
+int
+PipeBuffer::Write(const char *from, int size, bool wait)
+{
+    ASSERT(from != nullptr);
+    ASSERT(size >= 0);
+
+    lock->Acquire();
+    if (readers == 0) {
+        lock->Release();
+        return -1;
+    }
+    int n = 0;
+    while (n < size && readers > 0) {
+        if (count == PIPE_BUFFER_SIZE) {
+            if (!wait) {
+                break;
+            }
+            notEmpty->Broadcast();
+            pollers.WakeAll();
+            notFull->Wait();
+            continue;
+        }
+        buffer[(head + count) % PIPE_BUFFER_SIZE] = from[n++];
+        count++;
+    }
+    notEmpty->Broadcast();
+    pollers.WakeAll();
+    lock->Release();
+    return n;
+}
+
+void
+PipeBuffer::OpenEnd(bool writeEnd)
+{
+    lock->Acquire();
+    if (writeEnd) {
+        writers++;
+    } else {
+        readers++;
+    }
+    lock->Release();
+}
+
+void
+PipeBuffer::CloseEnd(bool writeEnd)
+{
+    lock->Acquire();
+    if (writeEnd) {
+        ASSERT(writers > 0);
+        writers--;
+        if (writers == 0) {
+            notEmpty->Broadcast();  // Readers must see the end of data.
+            pollers.WakeAll();
+        }
+    } else {
+        ASSERT(readers > 0);
+        readers--;
+        if (readers == 0) {
+            notFull->Broadcast();   // Writers must not wait forever.
+            pollers.WakeAll();
+        }
+    }
+    lock->Release();
+}
+
+bool
+PipeBuffer::IsClosed() const
+{
+    return readers == 0 && writers == 0;
+}
+
+bool
+PipeBuffer::CanReadNow() const
+{
+    return count > 0 || writers == 0;
+}
+
+bool
+PipeBuffer::CanWriteNow() const
+{
+    return count < PIPE_BUFFER_SIZE || readers == 0;
+}
+
+bool
+PipeBuffer::HasWriters() const
+{
+    return writers > 0;
+}
+
+bool
+PipeBuffer::HasReaders() const
+{
+    return readers > 0;
+}
+
+PollQueue *
+PipeBuffer::GetPollQueue()
+{
+    return &pollers;
+}
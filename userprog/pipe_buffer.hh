@@ -0,0 +1,75 @@
+/// In-kernel pipes, used to pass data between user programs without going
+/// through the file system.
+
+#ifndef NACHOS_USERPROG_PIPEBUFFER__HH
+#define NACHOS_USERPROG_PIPEBUFFER__HH
+
+
+#include "userprog/poll_queue.hh"
+
+
+class Lock;
+class Condition;
+
+
+/// Number of bytes a pipe can hold before writers block.
+const unsigned PIPE_BUFFER_SIZE = 512;
+
+/// A bounded byte ring shared by a number of readers and writers.
+///
+/// Reads block while the pipe is empty and there is some writer left; then
+/// they return whatever is available.  Writes block while the pipe is full
+/// and there is some reader left.
+class PipeBuffer {
+public:
+    PipeBuffer();
+    ~PipeBuffer();
+
+    /// Read up to `size` bytes.  Returns 0 once the pipe is empty and every
+    /// write end has been closed.  If `wait` is false and the pipe is empty
+    /// but still has writers, returns -1 instead of blocking.
+    int Read(char *buffer, int size, bool wait = true);
+
+    /// Write `size` bytes.  Returns the number of bytes written, which is
+    /// less than `size` only if every read end gets closed, or if `wait` is
+    /// false and the pipe fills up; -1 if there was no reader to begin
+    /// with.
+    int Write(const char *buffer, int size, bool wait = true);
+
+    /// Check whether a read or a write would return without blocking,
+    /// either because data or room is available or because the other side
+    /// is gone.
+    bool CanReadNow() const;
+    bool CanWriteNow() const;
+
+    /// Check whether every end on the other side has been closed.
+    bool HasWriters() const;
+    bool HasReaders() const;
+
+    /// Threads polling this pipe; woken whenever its state changes.
+    PollQueue *GetPollQueue();
+
+    /// Account for the opening and closing of read and write ends.
+    void OpenEnd(bool writeEnd);
+    void CloseEnd(bool writeEnd);
+
+    /// Check whether both ends are closed, so the pipe can be deleted.
+    bool IsClosed() const;
+
+private:
+    char buffer[PIPE_BUFFER_SIZE];
+    unsigned head;   ///< Index of the oldest byte.
+    unsigned count;  ///< Number of bytes held.
+
+    unsigned readers;
+    unsigned writers;
+
+    Lock *lock;
+    Condition *notEmpty;
+    Condition *notFull;
+
+    PollQueue pollers;
+};
+
+
+#endif
@@ -0,0 +1,31 @@
+/// Routines to manage poll wait queues.
+
+#include "userprog/poll_queue.hh"
+#include "threads/semaphore.hh"
+
+
+void
+PollQueue::Add(Semaphore *waiter)
+{
+    ASSERT(waiter != nullptr);
+    waiters.Append(waiter);
+}
+
+void
+PollQueue::Remove(Semaphore *waiter)
+{
+    ASSERT(waiter != nullptr);
+    waiters.Remove(waiter);
+}
+
+static void
+Wake(Semaphore *waiter)
+{
+    waiter->V();
+}
+
+void
+PollQueue::WakeAll()
+{
+    waiters.Apply(Wake);
+}
@@ -0,0 +1,32 @@
+/// Wait queues for threads polling a set of files.
+
+#ifndef NACHOS_USERPROG_POLLQUEUE__HH
+#define NACHOS_USERPROG_POLLQUEUE__HH
+
+
+#include "lib/list.hh"
+
+
+class Semaphore;
+
+
+/// The threads waiting for something to happen to a pipe or to the console.
+///
+/// A polling thread adds one semaphore to the queue of every object it
+/// polls and then waits on it; whatever changes the state of the object
+/// calls `WakeAll`.  Waiters stay queued until they remove themselves, so a
+/// single wake-up never gets lost between two checks.  `WakeAll` may be
+/// called from interrupt handlers.
+class PollQueue {
+public:
+    void Add(Semaphore *waiter);
+    void Remove(Semaphore *waiter);
+
+    void WakeAll();
+
+private:
+    List<Semaphore *> waiters;
+};
+
+
+#endif
@@ -25,17 +25,16 @@ StartProcess(const char *filename)
 {
     ASSERT(filename != nullptr);
 
-    OpenFile *executable = fileSystem->Open(filename);
+    Executable *executable = executableCache->Get(filename);
     if (executable == nullptr) {
         printf("Unable to open file %s\n", filename);
         return;
     }
 
-    AddressSpace *space = new AddressSpace(fileSystem->Open(filename), 0);
+    AddressSpace *space = new AddressSpace(executable,
+                                           currentThread->GetId());
     currentThread->space = space;
 
-    delete executable;
-
     space->InitRegisters();  // Set the initial register values.
     space->RestoreState();   // Load page table register.
 
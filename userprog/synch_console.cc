@@ -46,21 +46,29 @@ char SynchConsole::ReadChar()
     return ch;
 }
 
-void SynchConsole::ReadBuffer(char *buffer, int size)
+int SynchConsole::ReadBuffer(char *buffer, int size, bool wait)
 {
     ASSERT(buffer != NULL);
     ASSERT(size > 0);
     readLock->Acquire();
-    for (int i = 0; i < size; i++)
+    if (!wait && !console->HasInput())
     {
+        readLock->Release();
+        return -1;
+    }
+    int i = 0;
+    while (i < size && (wait || console->HasInput()))
+    {
+        // Characters typed ahead are already queued in the device, so this
+        // only waits when the line is not complete yet.
         buffer[i] = ReadChar();
-        if (buffer[i] == '\n')
+        if (buffer[i++] == '\n')
         {
             break;
         }
     }
     readLock->Release();
-    return;
+    return i;
 }
 
 void SynchConsole::WriteBuffer(char *buffer, int size)
@@ -68,17 +76,32 @@ void SynchConsole::WriteBuffer(char *buffer, int size)
     ASSERT(buffer != NULL);
     ASSERT(size > 0);
     writeLock->Acquire();
-    for (int i = 0; i < size; i++)
+    for (int i = 0; i < size; i += CONSOLE_BURST_SIZE)
     {
-        WriteChar(buffer[i]);
+        unsigned burst = size - i;
+        if (burst > CONSOLE_BURST_SIZE)
+            burst = CONSOLE_BURST_SIZE;
+        console->PutBuffer(&buffer[i], burst);
+        writeDone->P();  // One interrupt per burst.
     }
     writeLock->Release();
 }
 
 void SynchConsole::ReadAvailable(){
     readAvailable->V();
+    pollers.WakeAll();
 }
 
 void SynchConsole::WriteDone(){
     writeDone->V();
+}
+
+bool SynchConsole::CanReadNow() const
+{
+    return console->HasInput();
+}
+
+PollQueue *SynchConsole::GetPollQueue()
+{
+    return &pollers;
 }
\ No newline at end of file
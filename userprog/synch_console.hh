@@ -4,14 +4,25 @@
 #include "machine/console.hh"
 #include "threads/semaphore.hh"
 #include "threads/lock.hh"
+#include "userprog/poll_queue.hh"
 class SynchConsole {
 public:
     SynchConsole();
     ~SynchConsole();
-    void ReadBuffer(char *buffer, int size);
+    /// Read up to `size` characters, stopping after a newline.  Returns
+    /// the number of characters read.  If `wait` is false, only characters
+    /// already typed are read, and -1 is returned if there are none.
+    int ReadBuffer(char *buffer, int size, bool wait = true);
     void WriteBuffer(char *buffer, int size);
     void ReadAvailable();
     void WriteDone();
+
+    /// Check whether some typed character is waiting to be read.
+    bool CanReadNow() const;
+
+    /// Threads polling the console input; woken whenever a character
+    /// arrives.
+    PollQueue *GetPollQueue();
 private:
     char ReadChar();        
     void WriteChar(char ch); 
@@ -20,6 +31,7 @@ private:
     Lock *writeLock;
     Semaphore *readAvailable;
     Semaphore *writeDone;
+    PollQueue pollers;
 };
 
 
@@ -31,6 +31,43 @@
 #define SC_CLOSE   13
 #define SC_READ    14
 #define SC_WRITE   15
+#define SC_MMAP    16
+#define SC_MUNMAP  17
+#define SC_READV   18
+#define SC_WRITEV  19
+#define SC_ENTER   20
+#define SC_PIPE    21
+#define SC_DUP     22
+#define SC_DUP2    23
+#define SC_POLL    24
+#define SC_SETNONBLOCKING  25
+#define SC_SYNC    26
+#define SC_MKDIR   27
+#define SC_RMDIR   28
+#define SC_LISTDIR 29
+
+/// Maximum number of buffers accepted by `ReadV` and `WriteV`.
+#define IOV_MAX    16
+
+/// Number of slots in each queue of a `Ring`.
+#define RING_ENTRIES  32
+
+/// Operations that can be queued in a `Ring`.
+#define RING_OP_READ   0
+#define RING_OP_WRITE  1
+#define RING_OP_OPEN   2
+#define RING_OP_CLOSE  3
+
+/// Events reported by `Poll`.
+#define POLL_IN    1  // Reading would not block.
+#define POLL_OUT   2  // Writing would not block.
+#define POLL_HUP   4  // The other end of a pipe is closed.
+
+/// Maximum number of files accepted by `Poll`.
+#define POLL_MAX   16
+
+/// Returned by `Read` and `Write` on a non-blocking file that is not ready.
+#define E_WOULDBLOCK  (-2)
 
 
 #ifndef IN_ASM
@@ -95,6 +132,9 @@ typedef int OpenFileId;
 /// keyboard input and display output (in UNIX terms, stdin and stdout).
 /// Read and Write can be used directly on these, without first opening the
 /// console device.
+///
+/// A program started with `Exec` gets a copy of the open files of its
+/// parent, under the same ids, so these two may have been redirected.
 
 #define CONSOLE_INPUT   0
 #define CONSOLE_OUTPUT  1
@@ -105,6 +145,26 @@ int Create(const char *name);
 /// Remove the Nachos file named `name`.
 int Remove(const char *name);
 
+/// Write every modified disk sector still held in memory to the disk.
+/// Return 0.
+int Sync(void);
+
+/// File names may be paths: names separated by `/`, starting from the root
+/// directory.
+
+/// Create an empty directory named `name`.  Return 0, or -1 on error.
+int Mkdir(const char *name);
+
+/// Remove the empty directory named `name`.  Return 0, or -1 on error.
+int Rmdir(const char *name);
+
+/// Copy the names in directory `name` into `buffer`, one per line; names
+/// of directories end in `/`.  Return the number of bytes the whole listing
+/// takes, or -1 on error.  If that is more than `size`, the listing was cut
+/// short before the first name that did not fit, and can be asked for again
+/// with a larger buffer.
+int ListDir(const char *name, char *buffer, int size);
+
 /// Open the Nachos file `name`, and return an `OpenFileId` that can be used
 /// to read and write to the file.
 OpenFileId Open(const char *name);
@@ -123,6 +183,121 @@ int Read(char *buffer, int size, OpenFileId id);
 /// Close the file, we are done reading and writing to it.
 int Close(OpenFileId id);
 
+/// Create a pipe.  The id of its read end is stored in `ids[0]`, and the id
+/// of its write end in `ids[1]`.
+///
+/// Reading an empty pipe waits until some data is written, and returns 0
+/// once every write end is closed.  Writing to a pipe with no read end left
+/// returns -1.  Return 0, or -1 on error.
+int Pipe(OpenFileId ids[2]);
+
+/// Return a new id for the same open file as `id`, or -1 on error.
+OpenFileId Dup(OpenFileId id);
+
+/// Make `newId` refer to the same open file as `id`, closing what `newId`
+/// referred to before.  Return the id the file ends up under, which is
+/// `newId` unless that id had already been closed, or -1 on error.
+OpenFileId Dup2(OpenFileId id, OpenFileId newId);
+
+/// Make `Read` and `Write` on `id` return `E_WOULDBLOCK` instead of waiting
+/// (if `nonBlocking` is not 0), or wait again (if it is 0).  The mode is
+/// shared with every id copied from `id`.  Return 0, or -1 on error.
+int SetNonBlocking(OpenFileId id, int nonBlocking);
+
+/// A file watched by `Poll`.
+typedef struct PollFd {
+    OpenFileId id;
+    int events;   // `POLL_IN` and `POLL_OUT` events of interest.
+    int revents;  // Set by the kernel: events that hold, plus `POLL_HUP`.
+} PollFd;
+
+/// Wait until some of the `count` files in `fds` is ready for the events
+/// asked for, or until `timeout` ticks have passed.  A negative `timeout`
+/// waits forever and 0 does not wait at all.  At most `POLL_MAX` files are
+/// accepted.
+///
+/// The caller sleeps while waiting.  Return the number of entries with
+/// some event in `revents`, 0 on timeout, or -1 on error.
+int Poll(PollFd *fds, int count, int timeout);
+
+/// A buffer taking part in a vectored transfer.
+typedef struct IoVec {
+    void *buffer;
+    int length;
+} IoVec;
+
+/// Read from the open file into the `count` buffers of `vec`, filling each
+/// one before moving to the next.  At most `IOV_MAX` buffers are accepted.
+///
+/// Return the total number of bytes read, or -1 on error.
+int ReadV(const IoVec *vec, int count, OpenFileId id);
+
+/// Write the `count` buffers of `vec` to the open file, in order, as a
+/// single operation.  At most `IOV_MAX` buffers are accepted.
+///
+/// Return the total number of bytes written, or -1 on error.
+int WriteV(const IoVec *vec, int count, OpenFileId id);
+
+
+/// Batched requests: `Enter`.
+///
+/// A program queues requests in the submission queue of a `Ring` in its own
+/// memory, and a single `Enter` call runs all of them.  The kernel posts
+/// one completion per request, in order, carrying the `userData` of the
+/// request and the value the equivalent system call would have returned.
+///
+/// All fields are words, so the layout is the same for the kernel and user
+/// programs.  Buffer and file name addresses are passed as `int`.
+
+/// A queued request.
+typedef struct RingSqe {
+    int opcode;    // One of the `RING_OP_*` operations.
+    int id;        // File for `Read`, `Write` and `Close`.
+    int buffer;    // Data for `Read` and `Write`, file name for `Open`.
+    int length;    // Size of `buffer` for `Read` and `Write`.
+    int userData;  // Copied into the completion.
+} RingSqe;
+
+/// The result of a request.
+typedef struct RingCqe {
+    int userData;
+    int result;
+} RingCqe;
+
+/// Submission and completion queues.
+///
+/// Indexes only grow; the slot of index `i` is `i % RING_ENTRIES`.  The
+/// program advances `sqTail` and `cqHead`, the kernel advances `sqHead` and
+/// `cqTail`.
+typedef struct Ring {
+    unsigned sqHead;
+    unsigned sqTail;
+    unsigned cqHead;
+    unsigned cqTail;
+    RingSqe sq[RING_ENTRIES];
+    RingCqe cq[RING_ENTRIES];
+} Ring;
+
+/// Run every request queued in `ring`, as long as there is room for their
+/// completions.  The queue indexes and the slots of each request are kept
+/// resident only while the kernel accesses them, not the whole ring.
+///
+/// Return the number of requests run, or -1 on error.
+int Enter(Ring *ring);
+
+
+/// Memory-mapped files: `Mmap` and `Munmap`.
+
+/// Map `size` bytes of the open file `id`, starting at `offset` (which must
+/// be a multiple of the page size), into the address space of the program.
+///
+/// Pages are read from the file when first touched and modified pages are
+/// written back to it.  Return the address of the mapping, or -1 on error.
+void *Mmap(OpenFileId id, unsigned offset, unsigned size);
+
+/// Remove the mapping starting at `addr`, writing modified pages back.
+int Munmap(void *addr);
+
 
 #endif
 
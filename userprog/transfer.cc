@@ -7,6 +7,63 @@
 #include "lib/utility.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
+
+/// Return the number of bytes from user address `addr` to the end of its
+/// page, but at most `left`.
+static unsigned PageChunk(unsigned addr, unsigned left)
+{
+    unsigned chunk = PAGE_SIZE - addr % PAGE_SIZE;
+    return chunk < left ? chunk : left;
+}
+
+/// Copy `byteCount` bytes from the user buffer at `userAddress` into the
+/// kernel buffer `buffer`.
+///
+/// The user range is pinned for the whole copy, and every page is
+/// translated once and copied with a single `memcpy`.
+static void CopyFromUser(int userAddress, char *buffer, unsigned byteCount)
+{
+    AddressSpace *space = currentThread->space;
+    bool pinned = space->PinRange(userAddress, byteCount);
+    ASSERT(pinned);
+
+    unsigned addr = userAddress;
+    unsigned left = byteCount;
+    while (left > 0) {
+        unsigned chunk = PageChunk(addr, left);
+        const char *frame = &machine->mainMemory[space->PinnedToPhysical(addr, false)];
+        memcpy(buffer, frame, chunk);
+        addr += chunk;
+        buffer += chunk;
+        left -= chunk;
+    }
+
+    space->UnpinRange(userAddress, byteCount);
+}
+
+/// Copy `byteCount` bytes from the kernel buffer `buffer` into the user
+/// buffer at `userAddress`, the same way as `CopyFromUser`.
+static void CopyToUser(const char *buffer, int userAddress, unsigned byteCount)
+{
+    AddressSpace *space = currentThread->space;
+    bool pinned = space->PinRange(userAddress, byteCount);
+    ASSERT(pinned);
+
+    unsigned addr = userAddress;
+    unsigned left = byteCount;
+    while (left > 0) {
+        unsigned chunk = PageChunk(addr, left);
+        char *frame = &machine->mainMemory[space->PinnedToPhysical(addr, true)];
+        memcpy(frame, buffer, chunk);
+        addr += chunk;
+        buffer += chunk;
+        left -= chunk;
+    }
+
+    space->UnpinRange(userAddress, byteCount);
+}
 
 void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount)
@@ -15,18 +72,7 @@ void ReadBufferFromUser(int userAddress, char *outBuffer,
     ASSERT(outBuffer != nullptr);
     ASSERT(byteCount != 0);
 
-    for (unsigned i = 0; i < byteCount; i++) {
-        int temp;
-        bool success = false;
-        for(int j = 0; j < READLIMIT; j++){
-            if((success = machine->ReadMem(userAddress, 1, &temp))){
-                userAddress++;
-                break;
-            }
-        }
-        ASSERT(success);
-        *outBuffer++ = (unsigned char) temp;
-    }
+    CopyFromUser(userAddress, outBuffer, byteCount);
 }
 
 bool ReadStringFromUser(int userAddress, char *outString,
@@ -36,22 +82,30 @@ bool ReadStringFromUser(int userAddress, char *outString,
     ASSERT(outString != nullptr);
     ASSERT(maxByteCount != 0);
 
-    unsigned count = 0;
-    do {
-        int temp;
-        bool success = false;
-        for(int i=0; i<READLIMIT; i++){
-            if((success = machine->ReadMem(userAddress, 1, &temp))){
-                count++;
-                userAddress++;
-                *outString = (unsigned char) temp;
-                break;
-            }
+    // The length is not known in advance, so go one page at a time and
+    // stop at the first page holding the terminator.
+    AddressSpace *space = currentThread->space;
+    unsigned addr = userAddress;
+    unsigned left = maxByteCount;
+    while (left > 0) {
+        unsigned chunk = PageChunk(addr, left);
+        if (!space->PinRange(addr, chunk)) {
+            return false;  // Not part of the address space.
         }
-        ASSERT(success);
-    } while (*outString++ != '\0' && count < maxByteCount);
+        const char *frame = &machine->mainMemory[space->PinnedToPhysical(addr, false)];
+        const char *end = (const char *) memchr(frame, '\0', chunk);
+        unsigned length = end == nullptr ? chunk : end - frame + 1;
+        memcpy(outString, frame, length);
+        space->UnpinRange(addr, chunk);
 
-    return *(outString - 1) == '\0';
+        outString += length;
+        if (end != nullptr) {
+            return true;
+        }
+        addr += chunk;
+        left -= chunk;
+    }
+    return false;
 }
 
 void WriteBufferToUser(const char *buffer, int userAddress,
@@ -61,16 +115,7 @@ void WriteBufferToUser(const char *buffer, int userAddress,
     ASSERT(buffer != nullptr);
     ASSERT(byteCount != 0);
 
-    for (unsigned i = 0; i < byteCount; i++) {
-        bool success = false;
-        for(int j = 0; j < READLIMIT; j++){
-            if((success = machine->WriteMem(userAddress, 1, (int) *(buffer + i)))) {
-                userAddress++;
-                break;
-            }
-        }
-        ASSERT(success);
-    }
+    CopyToUser(buffer, userAddress, byteCount);
 }
 
 void WriteStringToUser(const char *string, int userAddress)
@@ -78,14 +123,5 @@ void WriteStringToUser(const char *string, int userAddress)
     ASSERT(userAddress != 0);
     ASSERT(string != nullptr);
 
-    do {
-        bool success = false;
-        for(int i=0; i<READLIMIT; i++){
-            if((success=machine->WriteMem(userAddress, 1, (int) *string))) {
-                userAddress++;
-                break;
-            }
-        }
-        ASSERT(success);
-    } while (*string++ != '\0');
+    CopyToUser(string, userAddress, strlen(string) + 1);
 }
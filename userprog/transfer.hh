@@ -12,6 +12,9 @@ void ReadBufferFromUser(int userAddress, char *outBuffer,
                         unsigned byteCount);
 
 /// Copy a C string from virtual machine to host.
+///
+/// Returns false if the string is longer than `maxByteCount` or runs out
+/// of the address space.
 bool ReadStringFromUser(int userAddress, char *outString,
                         unsigned maxByteCount);
 
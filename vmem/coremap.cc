@@ -6,10 +6,12 @@ CoreMap::CoreMap(int _numFrames) {
     // Initialize the coremap
     numFrames = _numFrames;
     coremap = new int * [numFrames];
+    pinCount = new unsigned [numFrames];
     for (int i = 0; i < numFrames; i++) {
         coremap[i] = new int[2];
         coremap[i][0] = -1;
         coremap[i][1] = -1;
+        pinCount[i] = 0;
     }
 }
 
@@ -19,6 +21,7 @@ CoreMap::~CoreMap() {
         delete[] coremap[i];
     }
     delete[] coremap;
+    delete[] pinCount;
 }
 
 int
@@ -48,6 +51,7 @@ CoreMap::Mark(int virtualAdress, int pid, int frame){
 void
 CoreMap::Clear(int frame){
     ASSERT(frame < numFrames);
+    ASSERT(pinCount[frame] == 0);
     coremap[frame][0] = -1;
     coremap[frame][1] = -1;
 }
@@ -56,11 +60,32 @@ int*
 CoreMap::getFrame(int frame){
     return coremap[frame];
 }
+
+void
+CoreMap::Pin(int frame){
+    ASSERT(frame < numFrames);
+    ASSERT(Test(frame));
+    pinCount[frame]++;
+}
+
+void
+CoreMap::Unpin(int frame){
+    ASSERT(frame < numFrames);
+    ASSERT(pinCount[frame] > 0);
+    pinCount[frame]--;
+}
+
+bool
+CoreMap::IsPinned(int frame){
+    ASSERT(frame < numFrames);
+    return pinCount[frame] > 0;
+}
+
 void
 CoreMap::Print(){
     for (int i = 0; i < numFrames; i++) {
         if (Test(i)) {
-            printf("Frame %d: Virtual Address: %d, PID: %d\n", i, coremap[i][0], coremap[i][1]);
+            printf("Frame %d: Virtual Address: %d, PID: %d, pins: %u\n", i, coremap[i][0], coremap[i][1], pinCount[i]);
         }
     }
 }
\ No newline at end of file
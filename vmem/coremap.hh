@@ -14,8 +14,16 @@ class CoreMap {
         bool Test(int frame);
         void Print();
         int *getFrame(int frame);
+
+        /// Keep `frame` from being chosen for replacement until a matching
+        /// `Unpin`.  Pins nest.
+        void Pin(int frame);
+        void Unpin(int frame);
+        bool IsPinned(int frame);
     private:
         int numFrames;
         int **coremap;
+        /// Number of outstanding pins for every frame.
+        unsigned *pinCount;
 };
 #endif // COREMAP_HH
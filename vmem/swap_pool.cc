@@ -0,0 +1,199 @@
+/// Routines to manage the compressed swap pool.
+///
+/// Pages are compressed with a PackBits-style run-length encoding: each
+/// chunk starts with a control byte `n`; if `n < 128`, the next `n + 1`
+/// bytes are copied literally, otherwise the single next byte is repeated
+/// `n - 125` times.  Stacks and uninitialized arrays are mostly made of long
+/// runs of zeroes, so they shrink to a few bytes.
+
+
+#include "swap_pool.hh"
+#include "machine/mmu.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+static const unsigned MAX_LITERAL = 128;
+static const unsigned MIN_RUN = 3;
+static const unsigned MAX_RUN = 130;
+
+/// Compress `PAGE_SIZE` bytes from `in` into `out`, returning the number of
+/// bytes written.  `out` must have room for `PAGE_SIZE + PAGE_SIZE / 128`
+/// bytes.
+static unsigned
+Compress(const char *in, char *out)
+{
+    unsigned i = 0, o = 0;
+
+    while (i < PAGE_SIZE) {
+        unsigned run = 1;
+        while (i + run < PAGE_SIZE && run < MAX_RUN
+                 && in[i + run] == in[i]) {
+            run++;
+        }
+        if (run >= MIN_RUN) {
+            out[o++] = (char) (run + 125);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        // Gather literals until the next run worth encoding.
+        unsigned start = i, count = 0;
+        while (i < PAGE_SIZE && count < MAX_LITERAL) {
+            if (i + 2 < PAGE_SIZE
+                  && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+                break;
+            }
+            i++;
+            count++;
+        }
+        out[o++] = (char) (count - 1);
+        memcpy(&out[o], &in[start], count);
+        o += count;
+    }
+    return o;
+}
+
+static void
+Decompress(const char *in, unsigned size, char *out)
+{
+    unsigned i = 0, o = 0;
+
+    while (i < size) {
+        unsigned n = (unsigned char) in[i++];
+        if (n < MAX_LITERAL) {
+            memcpy(&out[o], &in[i], n + 1);
+            i += n + 1;
+            o += n + 1;
+        } else {
+            memset(&out[o], in[i++], n - 125);
+            o += n - 125;
+        }
+    }
+    ASSERT(o == PAGE_SIZE);
+}
+
+SwapPool::SwapPool(unsigned aCapacity)
+{
+    capacity = aCapacity;
+    used = 0;
+    scratch = new char [PAGE_SIZE + DivRoundUp(PAGE_SIZE, MAX_LITERAL)];
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        buckets[i] = nullptr;
+    }
+}
+
+SwapPool::~SwapPool()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        while (buckets[i] != nullptr) {
+            Entry *e = buckets[i];
+            buckets[i] = e->next;
+            delete [] e->data;
+            delete e;
+        }
+    }
+    delete [] scratch;
+}
+
+unsigned
+SwapPool::Hash(int pid, unsigned vpn)
+{
+    return ((unsigned) pid * 31 + vpn) % NUM_BUCKETS;
+}
+
+SwapPool::Entry *
+SwapPool::Unlink(int pid, unsigned vpn)
+{
+    for (Entry **p = &buckets[Hash(pid, vpn)]; *p != nullptr;
+         p = &(*p)->next) {
+        Entry *e = *p;
+        if (e->pid == pid && e->vpn == vpn) {
+            *p = e->next;
+            used -= e->size;
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+bool
+SwapPool::Store(int pid, unsigned vpn, const char *page)
+{
+    ASSERT(page != nullptr);
+
+    // A stale copy may still be around; the new contents replace it.
+    Discard(pid, vpn);
+
+    unsigned size = Compress(page, scratch);
+    if (used + size > capacity) {
+        DEBUG('a', "Swap pool full, page %u of process %d spills to disk\n",
+              vpn, pid);
+        stats->swapPoolSpills++;
+        return false;
+    }
+
+    Entry *e = new Entry;
+    e->pid  = pid;
+    e->vpn  = vpn;
+    e->size = size;
+    e->data = new char [size];
+    memcpy(e->data, scratch, size);
+    e->next = buckets[Hash(pid, vpn)];
+    buckets[Hash(pid, vpn)] = e;
+    used += size;
+
+    DEBUG('a', "Stored page %u of process %d in swap pool, %u bytes\n",
+          vpn, pid, size);
+    stats->swapPoolStores++;
+    stats->swapPoolRawBytes += PAGE_SIZE;
+    stats->swapPoolCompressedBytes += size;
+    return true;
+}
+
+bool
+SwapPool::Load(int pid, unsigned vpn, char *page)
+{
+    ASSERT(page != nullptr);
+
+    Entry *e = Unlink(pid, vpn);
+    if (e == nullptr) {
+        return false;
+    }
+    Decompress(e->data, e->size, page);
+    delete [] e->data;
+    delete e;
+    stats->swapPoolHits++;
+    return true;
+}
+
+void
+SwapPool::Discard(int pid, unsigned vpn)
+{
+    Entry *e = Unlink(pid, vpn);
+    if (e != nullptr) {
+        delete [] e->data;
+        delete e;
+    }
+}
+
+void
+SwapPool::DiscardAll(int pid)
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        Entry **p = &buckets[i];
+        while (*p != nullptr) {
+            Entry *e = *p;
+            if (e->pid == pid) {
+                *p = e->next;
+                used -= e->size;
+                delete [] e->data;
+                delete e;
+            } else {
+                p = &e->next;
+            }
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/// Compressed in-memory cache for evicted pages.
+///
+/// Sits between page eviction and the swap file: evicted pages are
+/// compressed into a fixed-size pool kept by the host, and only go to the
+/// swap file when the pool has no room left for them.
+
+#ifndef NACHOS_VMEM_SWAPPOOL__HH
+#define NACHOS_VMEM_SWAPPOOL__HH
+
+
+/// Default capacity of the pool, in pages worth of compressed data.
+const unsigned DEFAULT_SWAP_POOL_PAGES = 32;
+
+
+class SwapPool {
+public:
+
+    /// Create an empty pool that can hold `capacity` bytes of compressed
+    /// page data.
+    SwapPool(unsigned capacity);
+
+    ~SwapPool();
+
+    /// Compress the page `vpn` of process `pid`, whose contents are in
+    /// `page`, and keep it in the pool.
+    ///
+    /// Returns false if there is no room left; the caller must then write
+    /// the page to the swap file.
+    bool Store(int pid, unsigned vpn, const char *page);
+
+    /// Decompress the page `vpn` of process `pid` into `page`, removing it
+    /// from the pool.
+    ///
+    /// Returns false if the pool does not hold that page.
+    bool Load(int pid, unsigned vpn, char *page);
+
+    /// Drop the page `vpn` of process `pid`, if the pool holds it.
+    void Discard(int pid, unsigned vpn);
+
+    /// Drop every page that belongs to process `pid`.
+    void DiscardAll(int pid);
+
+private:
+    struct Entry {
+        int pid;
+        unsigned vpn;
+        unsigned size;  ///< Length of `data`.
+        char *data;     ///< Compressed page.
+        Entry *next;
+    };
+
+    static const unsigned NUM_BUCKETS = 64;
+
+    Entry *buckets[NUM_BUCKETS];
+
+    unsigned capacity;
+    unsigned used;
+
+    /// Scratch buffer big enough for the worst case compression output.
+    char *scratch;
+
+    static unsigned Hash(int pid, unsigned vpn);
+
+    /// Remove the entry for `pid`/`vpn` from its bucket and return it, or
+    /// return null if there is none.
+    Entry *Unlink(int pid, unsigned vpn);
+};
+
+
+#endif